@@ -0,0 +1,173 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#include "LightSamplingService.h"
+#include "Utils/Timing/CpuTimer.h"
+
+namespace
+{
+const std::string kLightSamplingServiceKey = "LightSamplingService";
+} // namespace
+
+LightSamplingService::SharedPtr LightSamplingService::acquire(
+    const std::shared_ptr<Device>& pDevice,
+    RenderContext* pRenderContext,
+    const Scene::SharedPtr& pScene,
+    InternalDictionary& dict,
+    const void* pClient,
+    const Options& options
+)
+{
+    FALCOR_ASSERT(pScene);
+    SharedPtr pService = dict.getValue<SharedPtr>(kLightSamplingServiceKey, nullptr);
+    // The dictionary outlives the scene, a service of a previous scene is replaced.
+    if (!pService || pService->getScene() != pScene)
+    {
+        pService = SharedPtr(new LightSamplingService(pDevice, pScene));
+        dict[kLightSamplingServiceKey] = pService;
+    }
+    pService->beginFrame(pRenderContext, pClient, options);
+    return pService;
+}
+
+LightSamplingService::LightSamplingService(std::shared_ptr<Device> pDevice, const Scene::SharedPtr& pScene)
+    : mpDevice(std::move(pDevice)), mpScene(pScene)
+{}
+
+void LightSamplingService::beginFrame(RenderContext* pRenderContext, const void* pClient, const Options& options)
+{
+    // Every pass asks once per frame, so a pass which already got the service this frame means a new frame started.
+    const bool newFrame = mUpdateCount == 0 || std::find(mClients.begin(), mClients.end(), pClient) != mClients.end();
+    if (newFrame)
+    {
+        if (options.refitLightBVH != mOptions.refitLightBVH)
+        {
+            mOptions = options;
+            mOptionsChanged = true;
+        }
+        mClients.clear();
+        update(pRenderContext);
+    }
+    mClients.push_back(pClient);
+}
+
+void LightSamplingService::update(RenderContext* pRenderContext)
+{
+    if (mpScene->getRenderSettings().useEmissiveLights)
+    {
+        mpScene->getLightCollection(pRenderContext);
+    }
+
+    updateEmissiveSampler(pRenderContext);
+    updateEnvMapSampler();
+    mUpdateCount++;
+}
+
+void LightSamplingService::updateEmissiveSampler(RenderContext* pRenderContext)
+{
+    const bool lightsChanged = is_set(mpScene->getUpdates(), Scene::UpdateFlags::LightCollectionChanged);
+    mLastBVHUpdate = BVHUpdate::None;
+
+    if (!mpScene->useEmissiveLights())
+    {
+        // Keep the BVH for when the emissive lights are enabled again, it only has to be rebuilt if they changed meanwhile.
+        if (mpEmissiveSampler && lightsChanged)
+            mEmissiveSamplerStale = true;
+        return;
+    }
+
+    LightBVHSampler::Options samplerOptions;
+    samplerOptions.buildOptions.allowRefitting = mOptions.refitLightBVH;
+    const auto startTime = CpuTimer::getCurrentTimePoint();
+
+    if (!mpEmissiveSampler || mEmissiveSamplerStale)
+    {
+        const auto& pLights = mpScene->getLightCollection(pRenderContext);
+        FALCOR_ASSERT(pLights && pLights->getActiveLightCount(pRenderContext) > 0);
+        mpEmissiveSampler = LightBVHSampler::create(pRenderContext, mpScene, samplerOptions);
+        mpEmissiveSampler->update(pRenderContext);
+        mBuildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        mEmissiveSamplerStale = false;
+        mOptionsChanged = false;
+        return;
+    }
+
+    // Static emissive lights: the BVH is still valid, skip the update entirely.
+    if (!lightsChanged && !mOptionsChanged)
+    {
+        mStaticUpdates++;
+        return;
+    }
+
+    // New build options make the sampler rebuild the BVH on its next update, and so does every change without refitting.
+    const bool rebuild = mOptionsChanged || !mOptions.refitLightBVH;
+    if (mOptionsChanged)
+    {
+        mpEmissiveSampler->setOptions(samplerOptions);
+        mOptionsChanged = false;
+    }
+    mpEmissiveSampler->update(pRenderContext);
+
+    const double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    if (rebuild)
+    {
+        mRebuildTime = time;
+        mRebuildCount++;
+        mLastBVHUpdate = BVHUpdate::Rebuild;
+    }
+    else
+    {
+        mRefitTime = time;
+        mRefitCount++;
+        mLastBVHUpdate = BVHUpdate::Refit;
+    }
+}
+
+void LightSamplingService::updateEnvMapSampler()
+{
+    // Like the light BVH, the sampler of a disabled environment map is kept.
+    if (!mpScene->useEnvLight())
+        return;
+
+    // The importance map depends on the texture only, intensity and rotation changes keep it valid.
+    const auto& pEnvMap = mpScene->getEnvMap();
+    if (!mpEnvMapSampler || mpEnvMapSampler->getEnvMap() != pEnvMap)
+    {
+        const auto startTime = CpuTimer::getCurrentTimePoint();
+        mpEnvMapSampler = EnvMapSampler::create(mpDevice, pEnvMap);
+        mBuildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    }
+}
+
+Program::DefineList LightSamplingService::getDefines() const
+{
+    Program::DefineList defines;
+    if (auto pEmissiveSampler = getEmissiveSampler())
+        defines.add(pEmissiveSampler->getDefines());
+    return defines;
+}
+
+void LightSamplingService::setShaderData(const ShaderVar& var) const
+{
+    if (mpScene->useEmissiveLights())
+    {
+        FALCOR_ASSERT(mpEmissiveSampler);
+        mpEmissiveSampler->setShaderData(var["emissiveSampler"]);
+    }
+
+    if (mpScene->useEnvLight())
+    {
+        FALCOR_ASSERT(mpEnvMapSampler);
+        mpEnvMapSampler->setShaderData(var["envMapSampler"]);
+    }
+}
+
+void LightSamplingService::renderUI(Gui::Widgets& widget) const
+{
+    const char* lastUpdate = mLastBVHUpdate == BVHUpdate::Refit ? "refit" : mLastBVHUpdate == BVHUpdate::Rebuild ? "rebuild" : "none";
+    widget.text(fmt::format("Light BVH: {} refits, {} rebuilds, {} static frames", mRefitCount, mRebuildCount, mStaticUpdates));
+    widget.text(fmt::format("Last frame: {}", lastUpdate));
+    widget.text(fmt::format("Sampler build: {:.2f} ms (CPU)", mBuildTime));
+    widget.text(fmt::format("Last refit: {:.3f} ms, last rebuild: {:.2f} ms (CPU)", mRefitTime, mRebuildTime));
+    widget.tooltip("Shared by every pass of the graph. The GPU part of the refit is in the profiler, under LightBVHSampler::update.");
+}
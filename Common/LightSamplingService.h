@@ -0,0 +1,109 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "Rendering/Lights/LightBVHSampler.h"
+#include "Rendering/Lights/EnvMapSampler.h"
+
+using namespace Falcor;
+
+/** Emissive and environment map light samplers of a scene, shared by the render passes of a graph.
+
+    The service lives in the render graph dictionary: the first pass to execute creates it, the others bind the same
+    samplers instead of building their own. It is updated once per frame, by the first pass which asks for it again.
+
+    The update only does work when the scene reports a change of its lights: the light BVH is refitted (or rebuilt if
+    refitting is disabled) when the emissive geometry changed, and the environment map sampler is recreated when the
+    scene gets a different environment map. Samplers of a light type which gets disabled are kept, and only rebuilt on
+    enabling if the lights changed in between.
+*/
+class LightSamplingService
+{
+public:
+    using SharedPtr = std::shared_ptr<LightSamplingService>;
+
+    struct Options
+    {
+        // Refit the light BVH when the emissive geometry changes instead of rebuilding it.
+        bool refitLightBVH = true;
+    };
+
+    /** Work done on the light BVH by the last update.
+    */
+    enum class BVHUpdate
+    {
+        None,
+        Refit,
+        Rebuild,
+    };
+
+    /** Get the light samplers of a scene from the render graph dictionary, creating them if needed, and update them
+        if this is the first call of a new frame.
+        \param[in] pDevice GPU device.
+        \param[in] pRenderContext Render context.
+        \param[in] pScene Scene to sample the lights of.
+        \param[in] dict Render graph dictionary.
+        \param[in] pClient Identifies the calling pass. A pass asking twice starts a new frame.
+        \param[in] options Options of the calling pass, applied if it is the first pass of the frame.
+        \return The shared service.
+    */
+    static SharedPtr acquire(
+        const std::shared_ptr<Device>& pDevice,
+        RenderContext* pRenderContext,
+        const Scene::SharedPtr& pScene,
+        InternalDictionary& dict,
+        const void* pClient,
+        const Options& options
+    );
+
+    const Scene::SharedPtr& getScene() const { return mpScene; }
+    EmissiveLightSampler::SharedPtr getEmissiveSampler() const { return mpScene->useEmissiveLights() ? mpEmissiveSampler : nullptr; }
+    EnvMapSampler::SharedPtr getEnvMapSampler() const { return mpScene->useEnvLight() ? mpEnvMapSampler : nullptr; }
+
+    /** Defines of the emissive sampler, to add to the programs which sample it.
+    */
+    Program::DefineList getDefines() const;
+
+    /** Bind the samplers to the "emissiveSampler" and "envMapSampler" members of a parameter block.
+    */
+    void setShaderData(const ShaderVar& var) const;
+
+    /** Show the update statistics and the build and update times.
+    */
+    void renderUI(Gui::Widgets& widget) const;
+
+    /** CPU time of the last sampler creation and of the last refit and rebuild of the light BVH, in ms.
+        The GPU part of the refit is reported by the profiler under LightBVHSampler::update.
+    */
+    double getBuildTime() const { return mBuildTime; }
+    double getRefitTime() const { return mRefitTime; }
+    double getRebuildTime() const { return mRebuildTime; }
+
+private:
+    LightSamplingService(std::shared_ptr<Device> pDevice, const Scene::SharedPtr& pScene);
+    void beginFrame(RenderContext* pRenderContext, const void* pClient, const Options& options);
+    void update(RenderContext* pRenderContext);
+    void updateEmissiveSampler(RenderContext* pRenderContext);
+    void updateEnvMapSampler();
+
+    std::shared_ptr<Device> mpDevice;
+    Scene::SharedPtr mpScene;
+    LightBVHSampler::SharedPtr mpEmissiveSampler;
+    EnvMapSampler::SharedPtr mpEnvMapSampler;
+    Options mOptions;
+    bool mOptionsChanged = false;
+    // The emissive lights changed while they were disabled, so the kept BVH is out of date.
+    bool mEmissiveSamplerStale = false;
+
+    // Passes which got the service since the last update.
+    std::vector<const void*> mClients;
+    uint64_t mUpdateCount = 0;
+    uint64_t mStaticUpdates = 0;
+    uint64_t mRefitCount = 0;
+    uint64_t mRebuildCount = 0;
+    BVHUpdate mLastBVHUpdate = BVHUpdate::None;
+    double mBuildTime = 0.0;
+    double mRefitTime = 0.0;
+    double mRebuildTime = 0.0;
+};
@@ -0,0 +1,66 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#include "LightSelectionStats.h"
+
+namespace
+{
+// Low and high words of the fixed-point contribution sum and the sample count per light type.
+const uint32_t kStatsSize = 3 * 3 * sizeof(uint32_t);
+// Weight of the newest frame in the running average of the contribution per light type.
+const float kBlend = 0.1f;
+} // namespace
+
+void LightSelectionStats::beginFrame(RenderContext* pRenderContext)
+{
+    if (!mpStats)
+        mpStats = StatsReadback::create(mpDevice, kStatsSize);
+
+    mpStats->beginFrame(
+        pRenderContext,
+        [this](const uint32_t* pStats)
+        {
+            for (uint32_t type = 0; type < 3; type++)
+            {
+                const uint32_t* pType = pStats + 3 * type;
+                if (pType[2] == 0)
+                    continue;
+                const uint64_t sum = (uint64_t(pType[1]) << 32) | pType[0];
+                const float mean = float(double(sum) / (kFixedPointScale * pType[2]));
+                // The first measurement of a type replaces the initial zero instead of being blended with it.
+                float& contribution = mContributions[type];
+                contribution = contribution > 0.f ? contribution + kBlend * (mean - contribution) : mean;
+            }
+        }
+    );
+}
+
+void LightSelectionStats::endFrame(RenderContext* pRenderContext)
+{
+    FALCOR_ASSERT(mpStats);
+    mpStats->endFrame(pRenderContext);
+}
+
+void LightSelectionStats::reset()
+{
+    if (mpStats)
+        mpStats->reset();
+    mContributions = float3(0.f);
+}
+
+float3 LightSelectionStats::getLightTypeProbabilities(const Scene::SharedPtr& pScene, float floor) const
+{
+    if (!pScene)
+        return float3(0.f);
+    const float3 used =
+        float3(pScene->useEnvLight() ? 1.f : 0.f, pScene->useEmissiveLights() ? 1.f : 0.f, pScene->useAnalyticLights() ? 1.f : 0.f);
+    const float usedCount = used.x + used.y + used.z;
+    if (usedCount == 0.f)
+        return float3(0.f);
+
+    float3 p = used * mContributions;
+    const float sum = p.x + p.y + p.z;
+    p = sum > 0.f ? p / sum : used / usedCount;
+    const float minProbability = std::min(floor, 1.f / usedCount);
+    return used * (minProbability + (1.f - usedCount * minProbability) * p);
+}
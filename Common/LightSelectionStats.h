@@ -0,0 +1,59 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "StatsReadback.h"
+
+using namespace Falcor;
+
+/** Measured contribution of each light type, which the adaptive light type selection of a pass is proportional to.
+
+    The shaders accumulate the contribution of their samples per light type into getBuffer(), see
+    recordLightSelectionStats() in the PrepareReservoir shaders. The sums are read back a few frames later through
+    StatsReadback, so the CPU never waits for them.
+*/
+class LightSelectionStats
+{
+public:
+    using SharedPtr = std::shared_ptr<LightSelectionStats>;
+
+    // Must match kLightSelectionFixedPointScale in the StaticParams.slang of the passes.
+    static constexpr double kFixedPointScale = 1024.0;
+
+    static SharedPtr create(std::shared_ptr<Device> pDevice) { return SharedPtr(new LightSelectionStats(std::move(pDevice))); }
+
+    /** Blend the statistics of the completed copies into the contributions, and clear the sums for this frame.
+        Call before the passes which record statistics.
+    */
+    void beginFrame(RenderContext* pRenderContext);
+
+    /** Copy the sums of this frame to a free readback buffer.
+        Call after the passes which record statistics.
+    */
+    void endFrame(RenderContext* pRenderContext);
+
+    /** Forget the contributions and the copies in flight, e.g. when the scene changes.
+    */
+    void reset();
+
+    /** Fixed-point contribution sum, low and high words, and sample count per light type.
+    */
+    Buffer::SharedPtr getBuffer() const { return mpStats ? mpStats->getBuffer() : nullptr; }
+
+    /** Selection probability of the environment map, emissive and analytic lights.
+        Proportional to the measured contributions, uniform until there is any, then floored. Zero for the light types
+        the scene does not use.
+        \param[in] pScene Scene, may be null.
+        \param[in] floor Minimum probability of every used light type.
+    */
+    float3 getLightTypeProbabilities(const Scene::SharedPtr& pScene, float floor) const;
+
+private:
+    LightSelectionStats(std::shared_ptr<Device> pDevice) : mpDevice(std::move(pDevice)) {}
+
+    std::shared_ptr<Device> mpDevice;
+    // Created on the first frame which records statistics.
+    StatsReadback::SharedPtr mpStats;
+    float3 mContributions = float3(0.f);
+};
@@ -0,0 +1,52 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#include "StatsReadback.h"
+
+StatsReadback::StatsReadback(std::shared_ptr<Device> pDevice, uint32_t size)
+{
+    mpCounters = Buffer::create(
+        pDevice.get(), size, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr
+    );
+    for (auto& readback : mReadbacks)
+        readback.pBuffer = Buffer::create(pDevice.get(), size, ResourceBindFlags::None, Buffer::CpuAccess::Read, nullptr);
+}
+
+void StatsReadback::beginFrame(RenderContext* pRenderContext, const std::function<void(const uint32_t*)>& onReadback)
+{
+    // The copies are recorded in the command lists of the render context, which signals its fence on every submit.
+    const uint64_t completedValue = pRenderContext->getLowLevelData()->getFence()->getGpuValue();
+    for (uint32_t i = 0; i < kReadbackCount; i++)
+    {
+        Readback& readback = mReadbacks[(mNextReadback + i) % kReadbackCount];
+        if (!readback.pending)
+            continue;
+        if (readback.fenceValue > completedValue)
+            break;
+
+        onReadback(static_cast<const uint32_t*>(readback.pBuffer->map(Buffer::MapType::Read)));
+        readback.pBuffer->unmap();
+        readback.pending = false;
+    }
+
+    pRenderContext->clearUAV(mpCounters->getUAV().get(), uint4(0));
+}
+
+void StatsReadback::endFrame(RenderContext* pRenderContext)
+{
+    Readback& readback = mReadbacks[mNextReadback];
+    if (readback.pending)
+        return;
+
+    pRenderContext->copyResource(readback.pBuffer.get(), mpCounters.get());
+    // The value the fence gets on the next submit of the context, which executes the copy.
+    readback.fenceValue = pRenderContext->getLowLevelData()->getFence()->getCpuValue();
+    readback.pending = true;
+    mNextReadback = (mNextReadback + 1) % kReadbackCount;
+}
+
+void StatsReadback::reset()
+{
+    for (auto& readback : mReadbacks)
+        readback.pending = false;
+}
@@ -0,0 +1,64 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include <array>
+#include <functional>
+
+using namespace Falcor;
+
+/** GPU counters which the CPU reads back without stalling.
+
+    The shaders accumulate into getBuffer() during the frame. The counters of every frame are copied to one of
+    kReadbackCount readback buffers, and only read once the copy has completed on the GPU, a few frames later. A copy
+    is skipped if all the readback buffers are still in flight.
+*/
+class StatsReadback
+{
+public:
+    using SharedPtr = std::shared_ptr<StatsReadback>;
+
+    /** Create the counters and their readback buffers.
+        \param[in] pDevice GPU device.
+        \param[in] size Size of the counters in bytes.
+    */
+    static SharedPtr create(std::shared_ptr<Device> pDevice, uint32_t size)
+    {
+        return SharedPtr(new StatsReadback(std::move(pDevice), size));
+    }
+
+    /** Hand the completed copies to a callback, oldest first, and clear the counters for this frame.
+        Call before the passes which accumulate into the counters.
+    */
+    void beginFrame(RenderContext* pRenderContext, const std::function<void(const uint32_t*)>& onReadback);
+
+    /** Copy the counters of this frame to a free readback buffer.
+        Call after the passes which accumulate into the counters.
+    */
+    void endFrame(RenderContext* pRenderContext);
+
+    /** Forget the copies in flight, e.g. when the scene changes.
+    */
+    void reset();
+
+    const Buffer::SharedPtr& getBuffer() const { return mpCounters; }
+
+private:
+    StatsReadback(std::shared_ptr<Device> pDevice, uint32_t size);
+
+    static constexpr uint32_t kReadbackCount = 3;
+
+    struct Readback
+    {
+        Buffer::SharedPtr pBuffer;
+        // Value of the fence of the render context once the command list holding the copy has executed.
+        uint64_t fenceValue = 0;
+        bool pending = false;
+    };
+
+    Buffer::SharedPtr mpCounters;
+    std::array<Readback, kReadbackCount> mReadbacks;
+    // Readback buffer of the next copy. The copies in flight follow it, oldest first.
+    uint32_t mNextReadback = 0;
+};
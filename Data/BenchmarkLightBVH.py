@@ -0,0 +1,99 @@
+from falcor import *
+import json
+import os
+
+# Mogwai benchmark for the light BVH maintenance of the light samplers shared by the ReSTIR passes.
+# Usage: Mogwai --script Data/BenchmarkLightBVH.py
+# The scene is Data/ManyLights.pyscene with FALCOR_BENCH_EMISSIVE_COUNT emissive spheres of
+# FALCOR_BENCH_EMISSIVE_SEGMENTS segments, 128 spheres of 2 * 64^2 triangles by default, so ~1M emissive triangles,
+# of which FALCOR_BENCH_ANIMATED_COUNT move so that the BVH changes every frame.
+# The base scene of the generator is taken from MANYLIGHTS_BASE, the results are written to FALCOR_BENCH_OUTPUT.
+
+kGenerator = os.environ.get('FALCOR_BENCH_GENERATOR', 'Data/ManyLights.pyscene')
+kOutput = os.environ.get('FALCOR_BENCH_OUTPUT', 'LightBVH_benchmark.json')
+kEmissiveCount = os.environ.get('FALCOR_BENCH_EMISSIVE_COUNT', '128')
+kEmissiveSegments = os.environ.get('FALCOR_BENCH_EMISSIVE_SEGMENTS', '64')
+kAnimatedCount = os.environ.get('FALCOR_BENCH_ANIMATED_COUNT', '8')
+kWarmupFrames = 16
+kMeasureFrames = 128
+
+kBaseSettings = {'useInfiniteBounces': True, 'maxBounce': 10, 'analyticOnly': False}
+
+# name -> (ReSTIRGIPass dictionary on top of kBaseSettings, animate the scene)
+kConfigurations = {
+    'static': ({'lightBVHRefit': True}, False),
+    'refit': ({'lightBVHRefit': True}, True),
+    'rebuild': ({'lightBVHRefit': False}, True),
+}
+
+def render_graph_LightBVHBenchmark(settings):
+    g = RenderGraph('LightBVHBenchmark')
+    GBufferRT = createPass('GBufferRT', {'outputSize': IOSize.Default, 'samplePattern': SamplePattern.Center, 'sampleCount': 16, 'useAlphaTest': True, 'adjustShadingNormals': True, 'forceCullMode': False, 'cull': CullMode.CullBack, 'texLOD': TexLODMode.Mip0, 'useTraceRayInline': False, 'useDOF': True})
+    g.addPass(GBufferRT, 'GBufferRT')
+    ReSTIRGIPass = createPass('ReSTIRGIPass', settings)
+    g.addPass(ReSTIRGIPass, 'ReSTIRGIPass')
+    g.addEdge('GBufferRT.vbuffer', 'ReSTIRGIPass.vBuffer')
+    g.addEdge('GBufferRT.mvec', 'ReSTIRGIPass.motionVector')
+    g.addEdge('GBufferRT.depth', 'ReSTIRGIPass.depth')
+    g.markOutput('ReSTIRGIPass.color')
+    return g
+
+def find_event_time(capture, suffix):
+    for name, event in capture['events'].items():
+        if name.endswith(suffix):
+            return event['stats']['mean']
+    return None
+
+def run_configuration(name, settings, animate):
+    if m.activeGraph:
+        m.removeGraph(m.activeGraph)
+    m.addGraph(render_graph_LightBVHBenchmark(settings))
+    if animate:
+        m.clock.play()
+    else:
+        m.clock.pause()
+    for i in range(kWarmupFrames):
+        m.renderFrame()
+    m.profiler.enabled = True
+    m.profiler.startCapture()
+    for i in range(kMeasureFrames):
+        m.renderFrame()
+    capture = m.profiler.endCapture()
+    m.profiler.enabled = False
+    return {
+        'settings': settings,
+        'animated': animate,
+        'passGpuTimeMs': find_event_time(capture, '/ReSTIRGIPass/gpuTime'),
+        # GPU times, only present in frames where the BVH was refitted or rebuilt. The CPU times of these events only
+        # measure the command recording.
+        'bvhUpdateGpuTimeMs': find_event_time(capture, '/LightBVHSampler::update/gpuTime'),
+        'refitGpuTimeMs': find_event_time(capture, '/LightBVH::refit/gpuTime'),
+    }
+
+# The generator reads its parameters from the environment when the scene is loaded.
+os.environ['MANYLIGHTS_ANALYTIC'] = '0'
+os.environ['MANYLIGHTS_EMISSIVE'] = kEmissiveCount
+os.environ['MANYLIGHTS_EMISSIVE_SEGMENTS'] = kEmissiveSegments
+os.environ['MANYLIGHTS_ANIMATED'] = kAnimatedCount
+m.loadScene(kGenerator)
+
+results = {
+    'scene': kGenerator,
+    'emissiveCount': int(kEmissiveCount),
+    'emissiveSegments': int(kEmissiveSegments),
+    'animatedCount': int(kAnimatedCount),
+    'frames': kMeasureFrames,
+    'configurations': {},
+}
+for name, (config, animate) in kConfigurations.items():
+    settings = dict(kBaseSettings)
+    settings.update(config)
+    results['configurations'][name] = run_configuration(name, settings, animate)
+    print('{}: pass {} ms, BVH update {} ms, refit {} ms (GPU)'.format(
+        name, results['configurations'][name]['passGpuTimeMs'], results['configurations'][name]['bvhUpdateGpuTimeMs'],
+        results['configurations'][name]['refitGpuTimeMs']))
+
+with open(kOutput, 'w') as f:
+    json.dump(results, f, indent=4)
+
+exit()
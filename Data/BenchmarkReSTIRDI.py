@@ -0,0 +1,165 @@
+from falcor import *
+import csv
+import glob
+import json
+import os
+
+# Mogwai benchmark for the scaling of ReSTIRDIPass with the light count.
+# Usage: Mogwai --script Data/BenchmarkReSTIRDI.py
+# For every light count, Data/ManyLights.pyscene is generated with that many analytic lights, a reference is
+# accumulated with plain RIS, and every configuration is measured for GPU time and error against the reference.
+# The base scene of the generator is taken from MANYLIGHTS_BASE, the results are written to FALCOR_BENCH_OUTPUT.
+
+kGenerator = os.environ.get('FALCOR_BENCH_GENERATOR', 'Data/ManyLights.pyscene')
+kOutput = os.environ.get('FALCOR_BENCH_OUTPUT', 'ReSTIRDI_benchmark.json')
+kOutputDir = os.environ.get('FALCOR_BENCH_OUTPUT_DIR', 'ReSTIRDI_benchmark')
+kLightCounts = [int(x) for x in os.environ.get('FALCOR_BENCH_LIGHT_COUNTS', '1000,10000,100000,300000').split(',')]
+kEmissiveCount = os.environ.get('FALCOR_BENCH_EMISSIVE_COUNT', '1000')
+kWarmupFrames = 64
+kMeasureFrames = 256
+kReferenceFrames = 4096
+
+kBaseSettings = {'allLightSources': True, 'temporalReuseMaxM': 20, 'autoSetMaxM': True}
+kReferenceSettings = {'allLightSources': True, 'useReSTIR': False, 'risSampleNums': 32}
+
+# Candidate counts of the initial RIS.
+kRISSampleNums = [1, 4, 8, 16, 32]
+
+# name -> ReSTIRDIPass dictionary on top of kBaseSettings
+kReuseConfigurations = {
+    'risOnly': {'useReSTIR': False},
+    'temporal': {'useReSTIR': True, 'useTemporalReuse': True, 'useSpatialReuse': False},
+    'spatiotemporal': {'useReSTIR': True, 'useTemporalReuse': True, 'useSpatialReuse': True, 'spatialRadius': 5, 'spatialNeighbors': 4},
+    'spatiotemporalVisibility': {'useReSTIR': True, 'useTemporalReuse': True, 'useSpatialReuse': True, 'spatialRadius': 5, 'spatialNeighbors': 4, 'visibilityReuse': True},
+}
+
+# Many-light sampling strategies, measured at every light count with 8 candidates and spatiotemporal reuse.
+kSamplingConfigurations = {
+    'aliasTable': {'lightAliasTable': True},
+    'lightTiles': {'lightTiles': True},
+    'lightTilesAliasTable': {'lightTiles': True, 'lightAliasTable': True},
+    'presampledLights': {'presampledLights': True},
+}
+
+def add_gbuffer(g):
+    GBufferRT = createPass('GBufferRT', {'outputSize': IOSize.Default, 'samplePattern': SamplePattern.Center, 'sampleCount': 16, 'useAlphaTest': True, 'adjustShadingNormals': True, 'forceCullMode': False, 'cull': CullMode.CullBack, 'texLOD': TexLODMode.Mip0, 'useTraceRayInline': False, 'useDOF': False})
+    g.addPass(GBufferRT, 'GBufferRT')
+
+def add_restir_di(g, settings):
+    ReSTIRDIPass = createPass('ReSTIRDIPass', settings)
+    g.addPass(ReSTIRDIPass, 'ReSTIRDIPass')
+    g.addEdge('GBufferRT.mvec', 'ReSTIRDIPass.motionVecW')
+    g.addEdge('GBufferRT.viewW', 'ReSTIRDIPass.viewW')
+    g.addEdge('GBufferRT.depth', 'ReSTIRDIPass.depth')
+    g.addEdge('GBufferRT.normW', 'ReSTIRDIPass.normal')
+    g.addEdge('GBufferRT.vbuffer', 'ReSTIRDIPass.vBuffer')
+
+def render_graph_ReSTIRDIReference():
+    g = RenderGraph('ReSTIRDIReference')
+    add_gbuffer(g)
+    add_restir_di(g, kReferenceSettings)
+    AccumulatePass = createPass('AccumulatePass', {'enabled': True, 'outputSize': IOSize.Default, 'autoReset': True, 'precisionMode': AccumulatePrecision.Double, 'maxFrameCount': kReferenceFrames, 'overflowMode': AccumulateOverflowMode.Stop})
+    g.addPass(AccumulatePass, 'AccumulatePass')
+    g.addEdge('ReSTIRDIPass.color', 'AccumulatePass.input')
+    g.markOutput('AccumulatePass.output')
+    return g
+
+def render_graph_ReSTIRDIBenchmark(settings, referencePath, measurementsPath):
+    g = RenderGraph('ReSTIRDIBenchmark')
+    add_gbuffer(g)
+    add_restir_di(g, settings)
+    ErrorMeasurePass = createPass('ErrorMeasurePass', {'ReferenceImagePath': referencePath, 'MeasurementsFilePath': measurementsPath, 'IgnoreBackground': True, 'ComputeSquaredDifference': True, 'ComputeAverage': True, 'UseLoadedReference': True})
+    g.addPass(ErrorMeasurePass, 'ErrorMeasurePass')
+    g.addEdge('ReSTIRDIPass.color', 'ErrorMeasurePass.Source')
+    g.markOutput('ErrorMeasurePass.Output')
+    return g
+
+def set_graph(g):
+    if m.activeGraph:
+        m.removeGraph(m.activeGraph)
+    m.addGraph(g)
+
+def find_event_time(capture, suffix):
+    for name, event in capture['events'].items():
+        if name.endswith(suffix):
+            return event['stats']['mean']
+    return None
+
+def read_mean_errors(path, frames):
+    # Average every error column of the last frames, the warmup frames come first in the file.
+    with open(path) as f:
+        rows = list(csv.DictReader(f))[-frames:]
+    errors = {}
+    for column in (rows[0].keys() if rows else []):
+        values = [float(row[column]) for row in rows if row[column]]
+        errors[column.strip()] = sum(values) / len(values) if values else None
+    return errors
+
+def load_scene(lightCount):
+    # The generator reads its parameters from the environment when the scene is loaded.
+    os.environ['MANYLIGHTS_ANALYTIC'] = str(lightCount)
+    os.environ['MANYLIGHTS_EMISSIVE'] = kEmissiveCount
+    m.loadScene(kGenerator)
+    m.clock.pause()
+
+def render_reference(lightCount):
+    set_graph(render_graph_ReSTIRDIReference())
+    for i in range(kReferenceFrames):
+        m.renderFrame()
+    baseFilename = 'reference_{}'.format(lightCount)
+    m.frameCapture.outputDir = kOutputDir
+    m.frameCapture.baseFilename = baseFilename
+    m.frameCapture.capture()
+    return sorted(glob.glob(os.path.join(kOutputDir, baseFilename + '*.exr')))[-1]
+
+def run_configuration(lightCount, name, settings, referencePath):
+    measurementsPath = os.path.join(kOutputDir, '{}_{}.csv'.format(name, lightCount))
+    set_graph(render_graph_ReSTIRDIBenchmark(settings, referencePath, measurementsPath))
+    for i in range(kWarmupFrames):
+        m.renderFrame()
+    m.profiler.enabled = True
+    m.profiler.startCapture()
+    for i in range(kMeasureFrames):
+        m.renderFrame()
+    capture = m.profiler.endCapture()
+    m.profiler.enabled = False
+    # Close the measurements file before reading it.
+    set_graph(RenderGraph('Empty'))
+    return {
+        'settings': settings,
+        'gpuTimeMs': find_event_time(capture, '/ReSTIRDIPass/gpuTime'),
+        'cpuTimeMs': find_event_time(capture, '/ReSTIRDIPass/cpuTime'),
+        'frameTimeMs': find_event_time(capture, '/onFrameRender/gpuTime'),
+        'error': read_mean_errors(measurementsPath, kMeasureFrames),
+    }
+
+configurations = {}
+for reuseName, reuse in kReuseConfigurations.items():
+    for risSampleNums in kRISSampleNums:
+        settings = dict(kBaseSettings)
+        settings.update(reuse)
+        settings['risSampleNums'] = risSampleNums
+        configurations['{}_ris{}'.format(reuseName, risSampleNums)] = settings
+for samplingName, sampling in kSamplingConfigurations.items():
+    settings = dict(kBaseSettings)
+    settings.update(kReuseConfigurations['spatiotemporal'])
+    settings.update(sampling)
+    settings['risSampleNums'] = 8
+    configurations[samplingName] = settings
+
+os.makedirs(kOutputDir, exist_ok=True)
+results = {'generator': kGenerator, 'emissiveQuads': int(kEmissiveCount), 'frames': kMeasureFrames, 'referenceFrames': kReferenceFrames, 'lightCounts': {}}
+for lightCount in kLightCounts:
+    load_scene(lightCount)
+    referencePath = render_reference(lightCount)
+    lightResults = {'reference': referencePath, 'configurations': {}}
+    for name, settings in configurations.items():
+        lightResults['configurations'][name] = run_configuration(lightCount, name, settings, referencePath)
+        print('{} lights, {}: {} ms, error {}'.format(
+            lightCount, name, lightResults['configurations'][name]['gpuTimeMs'], lightResults['configurations'][name]['error']))
+    results['lightCounts'][str(lightCount)] = lightResults
+
+with open(kOutput, 'w') as f:
+    json.dump(results, f, indent=4)
+
+exit()
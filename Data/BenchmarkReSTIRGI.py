@@ -0,0 +1,96 @@
+from falcor import *
+import json
+import os
+
+# Mogwai benchmark for ReSTIRGIPass execution modes.
+# Usage: Mogwai --script Data/BenchmarkReSTIRGI.py
+# The scene is taken from FALCOR_BENCH_SCENE and the results are written to FALCOR_BENCH_OUTPUT.
+
+kScene = os.environ.get('FALCOR_BENCH_SCENE', 'Arcade/Arcade.pyscene')
+kOutput = os.environ.get('FALCOR_BENCH_OUTPUT', 'ReSTIRGI_benchmark.json')
+kWarmupFrames = 64
+kMeasureFrames = 256
+
+kBaseSettings = {'useInfiniteBounces': True, 'maxBounce': 10, 'analyticOnly': False}
+
+# name -> ReSTIRGIPass dictionary on top of kBaseSettings
+# Ray sorting pays off mostly on incoherent scenes, e.g. foliage or glossy materials, so set FALCOR_BENCH_SCENE accordingly.
+kConfigurations = {
+    'megakernel': {'wavefrontPathTracer': False},
+    'wavefront': {'wavefrontPathTracer': True},
+    'sortedRays': {'wavefrontPathTracer': False, 'sortSecondaryRays': True},
+    'sortedRaysWavefront': {'wavefrontPathTracer': True, 'sortSecondaryRays': True},
+    'deferredShading': {'wavefrontPathTracer': False, 'deferredSecondaryShading': True},
+    'sortedDeferredShading': {'wavefrontPathTracer': False, 'sortSecondaryRays': True, 'deferredSecondaryShading': True},
+    # The separate spatial pass draws other neighbors than the inline resampling, so its output differs.
+    'spatialPass': {'wavefrontPathTracer': False, 'spatialResamplingPass': True},
+    'spatialPass2Iterations': {'wavefrontPathTracer': False, 'spatialResamplingPass': True, 'spatialIterations': 2},
+    # Compare at equal error: the unbiased mode is meant to run with fewer neighbors.
+    'unbiasedSpatial2Neighbors': {
+        'wavefrontPathTracer': False, 'spatialResamplingPass': True, 'unbiasedSpatialResampling': True, 'spatialNeighborsCount': 2},
+    'unbiasedSpatial4Neighbors': {
+        'wavefrontPathTracer': False, 'spatialResamplingPass': True, 'unbiasedSpatialResampling': True, 'spatialNeighborsCount': 4},
+    # The reuse rate is shown in the Temporal Resampling group of the pass UI when 'reprojectionStats' is set.
+    'cameraReprojection': {'wavefrontPathTracer': False, 'motionVectorReprojection': False},
+    'motionVectorReprojection': {'wavefrontPathTracer': False, 'motionVectorReprojection': True},
+    # Connect a direct lighting input to reuse the full radiance; without it NEE is still traced at the reused hits.
+    'screenSpaceRadianceReuse': {'wavefrontPathTracer': False, 'screenSpaceRadianceReuse': True},
+    'reservoirGrid': {'wavefrontPathTracer': False, 'reservoirGrid': True},
+    'radianceCache': {'wavefrontPathTracer': False, 'radianceCache': True},
+    'radianceCacheWavefront': {'wavefrontPathTracer': True, 'radianceCache': True},
+    # The adaptive roulette needs the radiance cache, 'radianceCache' with the constant roulette is its baseline.
+    'adaptiveRouletteRadianceCache': {'wavefrontPathTracer': False, 'adaptiveRussianRoulette': True, 'radianceCache': True},
+    # Pays off with many analytic lights of different power and reach.
+    'lightGrid': {'wavefrontPathTracer': False, 'lightGrid': True},
+    # Pays off indoors, with the light entering through small openings.
+    'pathGuiding': {'wavefrontPathTracer': False, 'pathGuiding': True},
+    # Pays off when one light type dominates, e.g. a sun-lit scene with a few emissive meshes.
+    'adaptiveLightSelection': {'wavefrontPathTracer': False, 'adaptiveLightSelection': True},
+}
+
+def render_graph_ReSTIRGIBenchmark(settings):
+    g = RenderGraph('ReSTIRGIBenchmark')
+    GBufferRT = createPass('GBufferRT', {'outputSize': IOSize.Default, 'samplePattern': SamplePattern.Center, 'sampleCount': 16, 'useAlphaTest': True, 'adjustShadingNormals': True, 'forceCullMode': False, 'cull': CullMode.CullBack, 'texLOD': TexLODMode.Mip0, 'useTraceRayInline': False, 'useDOF': True})
+    g.addPass(GBufferRT, 'GBufferRT')
+    ReSTIRGIPass = createPass('ReSTIRGIPass', settings)
+    g.addPass(ReSTIRGIPass, 'ReSTIRGIPass')
+    g.addEdge('GBufferRT.vbuffer', 'ReSTIRGIPass.vBuffer')
+    g.addEdge('GBufferRT.mvec', 'ReSTIRGIPass.motionVector')
+    g.addEdge('GBufferRT.depth', 'ReSTIRGIPass.depth')
+    g.markOutput('ReSTIRGIPass.color')
+    return g
+
+def find_pass_time(capture, passName):
+    for name, event in capture['events'].items():
+        if name.endswith('/' + passName + '/gpuTime'):
+            return event['stats']['mean']
+    return None
+
+def run_configuration(name, settings):
+    if m.activeGraph:
+        m.removeGraph(m.activeGraph)
+    m.addGraph(render_graph_ReSTIRGIBenchmark(settings))
+    for i in range(kWarmupFrames):
+        m.renderFrame()
+    m.profiler.enabled = True
+    m.profiler.startCapture()
+    for i in range(kMeasureFrames):
+        m.renderFrame()
+    capture = m.profiler.endCapture()
+    m.profiler.enabled = False
+    return {'settings': settings, 'gpuTimeMs': find_pass_time(capture, 'ReSTIRGIPass')}
+
+m.loadScene(kScene)
+m.clock.pause()
+
+results = {'scene': kScene, 'frames': kMeasureFrames, 'configurations': {}}
+for name, config in kConfigurations.items():
+    settings = dict(kBaseSettings)
+    settings.update(config)
+    results['configurations'][name] = run_configuration(name, settings)
+    print('{}: {} ms'.format(name, results['configurations'][name]['gpuTimeMs']))
+
+with open(kOutput, 'w') as f:
+    json.dump(results, f, indent=4)
+
+exit()
@@ -8,7 +8,7 @@ def render_graph_DefaultRenderGraph():
     g.addPass(GBufferRaster, 'GBufferRaster')
     ToneMapper = createPass('ToneMapper', {'outputSize': IOSize.Default, 'useSceneMetadata': True, 'exposureCompensation': 0.0, 'autoExposure': False, 'filmSpeed': 100.0, 'whiteBalance': False, 'whitePoint': 6500.0, 'operator': ToneMapOp.Aces, 'clamp': True, 'whiteMaxLuminance': 1.0, 'whiteScale': 11.199999809265137, 'fNumber': 1.0, 'shutter': 1.0, 'exposureMode': ExposureMode.AperturePriority})
     g.addPass(ToneMapper, 'ToneMapper')
-    ReSTIRGIPass = createPass('ReSTIRGIPass')
+    ReSTIRGIPass = createPass('ReSTIRGIPass', {'motionVectorReprojection': True})
     g.addPass(ReSTIRGIPass, 'ReSTIRGIPass')
     g.addEdge('GBufferRaster.vbuffer', 'ReSTIRGIPass.vBuffer')
     g.addEdge('GBufferRaster.mvec', 'ReSTIRGIPass.motionVector')
@@ -6,7 +6,7 @@ def render_graph_ReSTIRGIaccum():
     g.addPass(ImageLoader, 'ImageLoader')
     ToneMapper = createPass('ToneMapper', {'outputSize': IOSize.Default, 'useSceneMetadata': True, 'exposureCompensation': 0.0, 'autoExposure': False, 'filmSpeed': 100.0, 'whiteBalance': False, 'whitePoint': 6500.0, 'operator': ToneMapOp.Aces, 'clamp': True, 'whiteMaxLuminance': 1.0, 'whiteScale': 11.199999809265137, 'fNumber': 1.0, 'shutter': 1.0, 'exposureMode': ExposureMode.AperturePriority})
     g.addPass(ToneMapper, 'ToneMapper')
-    ReSTIRGIPass = createPass('ReSTIRGIPass')
+    ReSTIRGIPass = createPass('ReSTIRGIPass', {'motionVectorReprojection': True})
     g.addPass(ReSTIRGIPass, 'ReSTIRGIPass')
     AccumulatePass = createPass('AccumulatePass', {'enabled': False, 'outputSize': IOSize.Default, 'autoReset': True, 'precisionMode': AccumulatePrecision.Single, 'maxFrameCount': 0, 'overflowMode': AccumulateOverflowMode.Stop})
     g.addPass(AccumulatePass, 'AccumulatePass')
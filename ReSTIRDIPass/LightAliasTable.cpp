@@ -0,0 +1,238 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#include "LightAliasTable.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace
+{
+const uint32_t kBenchmarkLightCounts[] = {1000, 10000, 100000, 1000000};
+const uint32_t kBenchmarkRuns = 3;
+
+uint32_t getThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/** Call func(i) for i in [0, count), the indices being handed out to the threads one by one.
+*/
+void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& func)
+{
+    threadCount = std::clamp(threadCount, 1u, std::max(count, 1u));
+    if (threadCount == 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::atomic<uint32_t> next = 0;
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (uint32_t i = next++; i < count; i = next++)
+                    func(i);
+            }
+        );
+    }
+    for (auto& thread : threads)
+        thread.join();
+}
+
+/** Build the alias table of one block with Vose's method.
+    \param[in] pWeights Weights of the block.
+    \param[in] size Number of entries of the block.
+    \param[in] totalWeight Sum of the weights of the whole table, normalizing the pdfs.
+    \param[in] firstIndex Index of the first entry of the block, added to the aliases.
+    \param[out] pEntries Entries of the block.
+*/
+void buildBlock(const float* pWeights, uint32_t size, double totalWeight, uint32_t firstIndex, LightAliasTable::Entry* pEntries)
+{
+    double blockWeight = 0.0;
+    for (uint32_t i = 0; i < size; i++)
+        blockWeight += pWeights[i];
+
+    // Scaled weights, 1 on average. A block without weight is never selected, its table is left uniform.
+    std::vector<double> scaled(size);
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        scaled[i] = blockWeight > 0.0 ? pWeights[i] * size / blockWeight : 1.0;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+        pEntries[s].threshold = (float)scaled[s];
+        pEntries[s].alias = firstIndex + l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // The entries left are full up to rounding errors.
+    for (uint32_t i : large)
+        pEntries[i] = {1.f, firstIndex + i};
+    for (uint32_t i : small)
+        pEntries[i] = {1.f, firstIndex + i};
+
+    for (uint32_t i = 0; i < size; i++)
+        pEntries[i].pdf = (float)(pWeights[i] / totalWeight);
+    for (uint32_t i = 0; i < size; i++)
+        pEntries[i].aliasPdf = pEntries[pEntries[i].alias - firstIndex].pdf;
+}
+} // namespace
+
+std::vector<LightAliasTable::Entry> LightAliasTable::build(const std::vector<float>& weights, uint32_t threadCount)
+{
+    const uint32_t lightCount = (uint32_t)weights.size();
+    const uint32_t blockCount = (lightCount + kBlockSize - 1) / kBlockSize;
+    std::vector<Entry> entries(lightCount + blockCount);
+    std::vector<float> blockWeights(blockCount);
+
+    parallelFor(
+        blockCount, threadCount,
+        [&](uint32_t block)
+        {
+            const uint32_t first = block * kBlockSize;
+            const uint32_t last = std::min(first + kBlockSize, lightCount);
+            double weight = 0.0;
+            for (uint32_t i = first; i < last; i++)
+                weight += weights[i];
+            blockWeights[block] = (float)weight;
+        }
+    );
+    double totalWeight = 0.0;
+    for (float weight : blockWeights)
+        totalWeight += weight;
+    FALCOR_ASSERT(totalWeight > 0.0);
+
+    parallelFor(
+        blockCount, threadCount,
+        [&](uint32_t block)
+        {
+            const uint32_t first = block * kBlockSize;
+            const uint32_t size = std::min(kBlockSize, lightCount - first);
+            buildBlock(weights.data() + first, size, totalWeight, first, entries.data() + first);
+        }
+    );
+    buildBlock(blockWeights.data(), blockCount, totalWeight, 0, entries.data() + lightCount);
+    return entries;
+}
+
+bool LightAliasTable::update(const Scene::SharedPtr& pScene)
+{
+    FALCOR_ASSERT(pScene);
+    const auto updates = pScene->getUpdates();
+    const bool lightsChanged = is_set(updates, Scene::UpdateFlags::LightIntensityChanged) ||
+                               is_set(updates, Scene::UpdateFlags::LightPropertiesChanged) ||
+                               is_set(updates, Scene::UpdateFlags::LightCountChanged);
+    const uint32_t lightCount = pScene->getActiveLightCount();
+    if (mpBuffer && lightCount == mLightCount && !lightsChanged)
+        return false;
+
+    mLightCount = lightCount;
+    if (lightCount == 0)
+    {
+        mpBuffer = nullptr;
+        return true;
+    }
+
+    const auto startTime = CpuTimer::getCurrentTimePoint();
+    const auto& lights = pScene->getActiveLights();
+    const float sceneRadius = pScene->getSceneBounds().radius();
+    std::vector<float> weights(lightCount);
+    parallelFor(
+        (lightCount + kBlockSize - 1) / kBlockSize, getThreadCount(),
+        [&](uint32_t block)
+        {
+            const uint32_t last = std::min((block + 1) * kBlockSize, lightCount);
+            for (uint32_t i = block * kBlockSize; i < last; i++)
+                weights[i] = getLightPower(lights[i]->getData(), sceneRadius);
+        }
+    );
+    // Without any measurable power, e.g. all lights black, fall back to uniform selection.
+    if (std::all_of(weights.begin(), weights.end(), [](float w) { return w <= 0.f; }))
+        std::fill(weights.begin(), weights.end(), 1.f);
+
+    const std::vector<Entry> entries = build(weights, getThreadCount());
+    if (mpBuffer && mpBuffer->getElementCount() == entries.size())
+    {
+        mpBuffer->setBlob(entries.data(), 0, entries.size() * sizeof(Entry));
+    }
+    else
+    {
+        mpBuffer = Buffer::createStructured(
+            mpDevice.get(), sizeof(Entry), (uint32_t)entries.size(), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None,
+            entries.data(), false
+        );
+    }
+    mBuildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    mBuildCount++;
+    return true;
+}
+
+float LightAliasTable::getLightPower(const LightData& data, float sceneRadius)
+{
+    const float intensity = std::max(0.f, dot(data.intensity, float3(0.2126f, 0.7152f, 0.0722f)));
+    switch ((LightType)data.type)
+    {
+    case LightType::Point:
+        // Solid angle of the spot cone, the full sphere for point lights.
+        return intensity * 2.f * (float)M_PI * (1.f - data.cosOpeningAngle);
+    case LightType::Directional:
+    case LightType::Distant:
+        return intensity * (float)M_PI * sceneRadius * sceneRadius;
+    case LightType::Rect:
+    case LightType::Disc:
+    case LightType::Sphere:
+        return intensity * (float)M_PI * data.surfaceArea;
+    default:
+        return intensity;
+    }
+}
+
+std::vector<LightAliasTable::BenchmarkResult> LightAliasTable::runBuildBenchmark()
+{
+    // Powers spread over several orders of magnitude, like a scene mixing small fixtures and large area lights.
+    std::mt19937 rng(0);
+    std::lognormal_distribution<float> power(0.f, 3.f);
+    std::vector<BenchmarkResult> results;
+
+    for (uint32_t lightCount : kBenchmarkLightCounts)
+    {
+        std::vector<float> weights(lightCount);
+        for (float& weight : weights)
+            weight = power(rng);
+
+        for (uint32_t threadCount : {1u, getThreadCount()})
+        {
+            BenchmarkResult result;
+            result.lightCount = lightCount;
+            result.threadCount = threadCount;
+            for (uint32_t run = 0; run < kBenchmarkRuns; run++)
+            {
+                const auto startTime = CpuTimer::getCurrentTimePoint();
+                const auto entries = build(weights, threadCount);
+                result.buildTime += CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / kBenchmarkRuns;
+            }
+            logInfo("LightAliasTable: {} lights, {} threads: {:.3f} ms", result.lightCount, result.threadCount, result.buildTime);
+            results.push_back(result);
+            if (getThreadCount() == 1)
+                break;
+        }
+    }
+    return results;
+}
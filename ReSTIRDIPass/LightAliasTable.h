@@ -0,0 +1,77 @@
+/***************************************************************************
+ # Copyright (c) 2023, udemegane All rights reserved.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+using namespace Falcor;
+
+/** Alias table over the power of the analytic lights of a scene, for constant time power proportional selection.
+
+    The table is built on the CPU. The lights are split in blocks of kBlockSize lights which get their own alias table,
+    so that the blocks are built in parallel, and a second alias table selects the blocks in proportion to their power.
+    The layout is described in LightAliasTable.slang. The table is only rebuilt when the scene reports a change of the
+    light intensities, properties or count.
+*/
+class LightAliasTable
+{
+public:
+    using SharedPtr = std::shared_ptr<LightAliasTable>;
+
+    // Must match kLightAliasBlockSize in LightAliasTable.slang.
+    static constexpr uint32_t kBlockSize = 4096;
+
+    struct Entry
+    {
+        float threshold = 1.f;
+        uint32_t alias = 0;
+        float pdf = 0.f;
+        float aliasPdf = 0.f;
+    };
+
+    struct BenchmarkResult
+    {
+        uint32_t lightCount = 0;
+        uint32_t threadCount = 0;
+        double buildTime = 0.0;
+    };
+
+    static SharedPtr create(std::shared_ptr<Device> pDevice) { return SharedPtr(new LightAliasTable(std::move(pDevice))); }
+
+    /** Rebuild the table if the analytic lights changed since the last update.
+        \param[in] pScene Scene to sample the lights of.
+        \return True if the table was rebuilt.
+    */
+    bool update(const Scene::SharedPtr& pScene);
+
+    /** Build the table entries of a set of light weights.
+        \param[in] weights Non-negative weight of each light, not all zero.
+        \param[in] threadCount Number of threads building the blocks.
+        \return The light entries followed by the block entries.
+    */
+    static std::vector<Entry> build(const std::vector<float>& weights, uint32_t threadCount);
+
+    /** Time the build of tables of 1K to 1M lights with random weights, single threaded and with every core.
+    */
+    static std::vector<BenchmarkResult> runBuildBenchmark();
+
+    /** Estimate of the power a light emits into the scene, luminance based.
+        Directional and distant lights are counted over the cross section of the scene bounds.
+    */
+    static float getLightPower(const LightData& data, float sceneRadius);
+
+    const Buffer::SharedPtr& getBuffer() const { return mpBuffer; }
+    uint32_t getLightCount() const { return mLightCount; }
+    uint64_t getBuildCount() const { return mBuildCount; }
+    // CPU time of the last build and upload, in ms.
+    double getBuildTime() const { return mBuildTime; }
+
+private:
+    LightAliasTable(std::shared_ptr<Device> pDevice) : mpDevice(std::move(pDevice)) {}
+
+    std::shared_ptr<Device> mpDevice;
+    Buffer::SharedPtr mpBuffer;
+    uint32_t mLightCount = 0;
+    uint64_t mBuildCount = 0;
+    double mBuildTime = 0.0;
+};
@@ -11,7 +11,9 @@ namespace
 {
 const std::string kReflectTypesFile = "RenderPasses/ReSTIRDIPass/ReflectTypes.cs.slang";
 const std::string kTracePassFile = "RenderPasses/ReSTIRDIPass/PrepareReservoir.cs.slang";
-const std::string kSpatioResamplingFileName = "RenderPasses/ReSTIRDIPass/FinalShading.cs.slang";
+const std::string kCullLightTilesFile = "RenderPasses/ReSTIRDIPass/CullLightTiles.cs.slang";
+const std::string kSpatialResamplingFile = "RenderPasses/ReSTIRDIPass/SpatialResampling.cs.slang";
+const std::string kFinalShadingFile = "RenderPasses/ReSTIRDIPass/FinalShading.cs.slang";
 
 const std::string kShaderModel = "6_5";
 
@@ -45,6 +47,65 @@ const char kUseTemporalReuse[] = "useTemporalReuse";
 const char kUseSpatialReuse[] = "useSpatialReuse";
 const char kSpatialRadius[] = "spatialRadius";
 const char kSpatialNeighbors[] = "spatialNeighbors";
+const char kSpatialIterations[] = "spatialIterations";
+const char kUseAllLightSources[] = "allLightSources";
+const char kUseAdaptiveLightSelection[] = "adaptiveLightSelection";
+const char kLightSelectionFloor[] = "lightSelectionFloor";
+const char kRefitLightBVH[] = "lightBVHRefit";
+const char kUsePresampledLights[] = "presampledLights";
+const char kPresampledTileCount[] = "presampledTileCount";
+const char kPresampledTileSize[] = "presampledTileSize";
+const char kUseLightAliasTable[] = "lightAliasTable";
+const char kUseLightTiles[] = "lightTiles";
+const char kLightTileSize[] = "lightTileSize";
+const char kLightTileCapacity[] = "lightTileCapacity";
+const char kLightTileFallback[] = "lightTileFallback";
+const char kUseVisibilityReuse[] = "visibilityReuse";
+const char kUseVisibilityCache[] = "visibilityCache";
+
+const float kMinLightSelectionFloor = 0.01f;
+const uint32_t kMaxPresampledTileCount = 1024;
+const uint32_t kMinPresampledTileSize = 16;
+const uint32_t kMaxPresampledTileSize = 8192;
+const uint32_t kMinLightTileSize = 4;
+const uint32_t kMaxLightTileSize = 64;
+// Bounded by the group shared memory of the culling pass.
+const uint32_t kMaxLightTileCapacity = 256;
+const float kMinLightTileFallback = 0.01f;
+const uint32_t kMaxSpatialRadius = 64;
+const uint32_t kMaxSpatialNeighbors = 32;
+const uint32_t kMaxSpatialIterations = 4;
+// Must match kNeighborOffsetCount in StaticParams.slang.
+const uint32_t kNeighborOffsetCount = 256;
+// Scene changes which move the primary hits or the lights, and so invalidate the cached shadow rays.
+const Scene::UpdateFlags kVisibilityCacheUpdateFlags[] = {
+    Scene::UpdateFlags::CameraMoved,
+    Scene::UpdateFlags::GeometryChanged,
+    Scene::UpdateFlags::LightsMoved,
+    Scene::UpdateFlags::LightPropertiesChanged,
+    Scene::UpdateFlags::LightCountChanged,
+    Scene::UpdateFlags::LightCollectionChanged,
+};
+
+/** Points of the unit disk from the R2 sequence, the 2D generalization of the golden ratio sequence. Any run of
+    consecutive points is spread evenly over the disk, so a pixel can take its neighbors from a random start.
+*/
+std::vector<float2> createNeighborOffsets()
+{
+    const double g = 1.32471795724474602596; // Plastic number, root of x^3 = x + 1.
+    const double a1 = 1.0 / g;
+    const double a2 = 1.0 / (g * g);
+    std::vector<float2> offsets(kNeighborOffsetCount);
+    for (uint32_t i = 0; i < kNeighborOffsetCount; i++)
+    {
+        const double u = std::fmod(0.5 + a1 * (i + 1), 1.0);
+        const double v = std::fmod(0.5 + a2 * (i + 1), 1.0);
+        const double r = std::sqrt(u);
+        const double phi = 2.0 * M_PI * v;
+        offsets[i] = float2((float)(r * std::cos(phi)), (float)(r * std::sin(phi)));
+    }
+    return offsets;
+}
 } // namespace
 
 extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registry)
@@ -56,6 +117,7 @@ ReSTIRDIPass::ReSTIRDIPass(std::shared_ptr<Device> pDevice, const Dictionary& di
 {
     parseDictionary(dict);
     mpSampleGenerator = SampleGenerator::create(mpDevice, SAMPLE_GENERATOR_TINY_UNIFORM);
+    mpLightSelectionStats = LightSelectionStats::create(mpDevice);
     if (!mpDevice->isFeatureSupported(Device::SupportedFeatures::RaytracingTier1_1))
         logError("Inline Raytracing is not supported on this device.");
 }
@@ -102,7 +164,78 @@ void ReSTIRDIPass::parseDictionary(const Dictionary& dict)
         {
             mStaticParams.mSpatialNeighbors = v;
         }
+        else if (k == kSpatialIterations)
+        {
+            mStaticParams.mSpatialIterations = v;
+        }
+        else if (k == kUseAllLightSources)
+        {
+            mStaticParams.mUseAllLightSources = v;
+        }
+        else if (k == kUseAdaptiveLightSelection)
+        {
+            mStaticParams.mUseAdaptiveLightSelection = v;
+        }
+        else if (k == kLightSelectionFloor)
+        {
+            mStaticParams.mLightSelectionFloor = v;
+        }
+        else if (k == kRefitLightBVH)
+        {
+            mStaticParams.mRefitLightBVH = v;
+        }
+        else if (k == kUsePresampledLights)
+        {
+            mStaticParams.mUsePresampledLights = v;
+        }
+        else if (k == kPresampledTileCount)
+        {
+            mStaticParams.mPresampledTileCount = v;
+        }
+        else if (k == kPresampledTileSize)
+        {
+            mStaticParams.mPresampledTileSize = v;
+        }
+        else if (k == kUseLightAliasTable)
+        {
+            mStaticParams.mUseLightAliasTable = v;
+        }
+        else if (k == kUseLightTiles)
+        {
+            mStaticParams.mUseLightTiles = v;
+        }
+        else if (k == kLightTileSize)
+        {
+            mStaticParams.mLightTileSize = v;
+        }
+        else if (k == kLightTileCapacity)
+        {
+            mStaticParams.mLightTileCapacity = v;
+        }
+        else if (k == kLightTileFallback)
+        {
+            mStaticParams.mLightTileFallback = v;
+        }
+        else if (k == kUseVisibilityReuse)
+        {
+            mStaticParams.mUseVisibilityReuse = v;
+        }
+        else if (k == kUseVisibilityCache)
+        {
+            mStaticParams.mUseVisibilityCache = v;
+        }
     }
+    mStaticParams.mSpatialRadius = std::clamp(mStaticParams.mSpatialRadius, 1u, kMaxSpatialRadius);
+    mStaticParams.mSpatialNeighbors = std::clamp(mStaticParams.mSpatialNeighbors, 1u, kMaxSpatialNeighbors);
+    mStaticParams.mSpatialIterations = std::clamp(mStaticParams.mSpatialIterations, 1u, kMaxSpatialIterations);
+    // A light type with zero probability would never be sampled, which biases the estimate.
+    mStaticParams.mLightSelectionFloor = std::clamp(mStaticParams.mLightSelectionFloor, kMinLightSelectionFloor, 1.f / 3.f);
+    mStaticParams.mPresampledTileCount = std::clamp(mStaticParams.mPresampledTileCount, 1u, kMaxPresampledTileCount);
+    mStaticParams.mPresampledTileSize = std::clamp(mStaticParams.mPresampledTileSize, kMinPresampledTileSize, kMaxPresampledTileSize);
+    mStaticParams.mLightTileSize = std::clamp(mStaticParams.mLightTileSize, kMinLightTileSize, kMaxLightTileSize);
+    mStaticParams.mLightTileCapacity = std::clamp(mStaticParams.mLightTileCapacity, 1u, kMaxLightTileCapacity);
+    // The fallback keeps every light reachable, which the lists alone do not.
+    mStaticParams.mLightTileFallback = std::clamp(mStaticParams.mLightTileFallback, kMinLightTileFallback, 1.f);
 }
 
 Dictionary ReSTIRDIPass::getScriptingDictionary()
@@ -116,6 +249,21 @@ Dictionary ReSTIRDIPass::getScriptingDictionary()
     dict[kUseSpatialReuse] = mStaticParams.mUseSpatialReuse;
     dict[kSpatialRadius] = mStaticParams.mSpatialRadius;
     dict[kSpatialNeighbors] = mStaticParams.mSpatialNeighbors;
+    dict[kSpatialIterations] = mStaticParams.mSpatialIterations;
+    dict[kUseAllLightSources] = mStaticParams.mUseAllLightSources;
+    dict[kUseAdaptiveLightSelection] = mStaticParams.mUseAdaptiveLightSelection;
+    dict[kLightSelectionFloor] = mStaticParams.mLightSelectionFloor;
+    dict[kRefitLightBVH] = mStaticParams.mRefitLightBVH;
+    dict[kUsePresampledLights] = mStaticParams.mUsePresampledLights;
+    dict[kPresampledTileCount] = mStaticParams.mPresampledTileCount;
+    dict[kPresampledTileSize] = mStaticParams.mPresampledTileSize;
+    dict[kUseLightAliasTable] = mStaticParams.mUseLightAliasTable;
+    dict[kUseLightTiles] = mStaticParams.mUseLightTiles;
+    dict[kLightTileSize] = mStaticParams.mLightTileSize;
+    dict[kLightTileCapacity] = mStaticParams.mLightTileCapacity;
+    dict[kLightTileFallback] = mStaticParams.mLightTileFallback;
+    dict[kUseVisibilityReuse] = mStaticParams.mUseVisibilityReuse;
+    dict[kUseVisibilityCache] = mStaticParams.mUseVisibilityCache;
     return dict;
 }
 
@@ -136,11 +284,22 @@ void ReSTIRDIPass::compile(RenderContext* pRenderContext, const CompileData& com
 void ReSTIRDIPass::setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene)
 {
     mFrameCount = 0;
+    mpLightSelectionStats->reset();
     mpScene = pScene;
     mpIntermediateReservoir = nullptr;
     mpReflectTypes = nullptr;
     mpTracePass = nullptr;
+    mpPresampleLightsPass = nullptr;
+    mpPresampledLights = nullptr;
+    mpCullLightTilesPass = nullptr;
     mpSpatialResampling = nullptr;
+    mpFinalShading = nullptr;
+    mpSpatialReservoirs[0] = nullptr;
+    mpSpatialReservoirs[1] = nullptr;
+    mpLightSampling = nullptr;
+    mpLightAliasTable = nullptr;
+    mpVisibilityCache = nullptr;
+    mVisibilityCacheValid = false;
 }
 
 void ReSTIRDIPass::execute(RenderContext* pRenderContext, const RenderData& renderData)
@@ -161,56 +320,10 @@ void ReSTIRDIPass::execute(RenderContext* pRenderContext, const RenderData& rend
         mOptionsChanged = false;
     }
 
-    //====================================
-    // Start Scene Light Settings
-    bool lightingChanged = false;
-
-    if (mpScene->getRenderSettings().useEmissiveLights)
-    {
-        mpScene->getLightCollection(pRenderContext);
-    }
-
-    if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::RenderSettingsChanged))
-    {
-        lightingChanged = true;
-    }
-    if (mpScene->useEmissiveLights())
-    {
-        if (!mpEmissiveSampler)
-        {
-            const auto& pLights = mpScene->getLightCollection(pRenderContext);
-            FALCOR_ASSERT(pLights && pLights->getActiveLightCount(pRenderContext) > 0);
-            FALCOR_ASSERT(!mpEmissiveSampler);
-            mpEmissiveSampler = LightBVHSampler::create(pRenderContext, mpScene);
-            lightingChanged = true;
-        }
-    }
-    else
-    {
-        mpEmissiveSampler = nullptr;
-        lightingChanged = true;
-    }
-
-    if (mpScene->useEnvLight())
-    {
-        if (!mpEnvMapSampler)
-        {
-            mpEnvMapSampler = EnvMapSampler::create(mpDevice, mpScene->getEnvMap());
-            lightingChanged = true;
-            //
-        }
-    }
-    else
-    {
-        mpEnvMapSampler = nullptr;
-        lightingChanged = true;
-    }
-    if (mpEmissiveSampler)
-    {
-        mpEmissiveSampler->update(pRenderContext);
-    }
-    // End Scene light Settings.
-    //====================================
+    // Built by whichever pass of the graph executes first, updated once per frame.
+    LightSamplingService::Options lightSamplingOptions;
+    lightSamplingOptions.refitLightBVH = mStaticParams.mRefitLightBVH;
+    mpLightSampling = LightSamplingService::acquire(mpDevice, pRenderContext, mpScene, dict, this, lightSamplingOptions);
 
     const auto& pVBuffer = renderData.getTexture(kInputVBuffer);
     const auto& pMVec = renderData.getTexture(kInputMotionVector);
@@ -218,8 +331,19 @@ void ReSTIRDIPass::execute(RenderContext* pRenderContext, const RenderData& rend
     const auto& pViewW = renderData.getTexture(kInputViewW);
 
     prepareResources(pRenderContext, renderData);
+    if (mStaticParams.mUsePresampledLights)
+        presampleLights(pRenderContext);
+    if (useLightTiles())
+        cullLightTiles(pRenderContext, pVBuffer);
     prepareReservoir(pRenderContext, renderData, pVBuffer, pDepth, pViewW, pMVec);
-    finalShading(pRenderContext, renderData, pVBuffer, pDepth, pViewW);
+    // The temporal history keeps the reservoirs before the spatial reuse, the shading gets those after it.
+    const Buffer::SharedPtr pReservoir =
+        useSpatialResampling() ? spatialResampling(pRenderContext, renderData, pVBuffer, pViewW) : mpIntermediateReservoir;
+    finalShading(pRenderContext, renderData, pVBuffer, pDepth, pViewW, pReservoir);
+    if (useAdaptiveLightSelection())
+        mpLightSelectionStats->endFrame(pRenderContext);
+    else
+        mpLightSelectionStats->reset();
     endFrame(pRenderContext, renderData);
 }
 
@@ -230,8 +354,23 @@ Program::DefineList ReSTIRDIPass::getDefines()
     defines.add("USE_EMISSIVE_LIGHTS", mpScene->useEmissiveLights() ? "1" : "0");
     defines.add("USE_ANALYTIC_LIGHTS", mpScene->useAnalyticLights() ? "1" : "0");
     defines.add("USE_RESTIR", mStaticParams.mUseReSTIR ? "1" : "0");
-    if (mpEmissiveSampler)
-        defines.add(mpEmissiveSampler->getDefines());
+    defines.add("USE_SPATIAL_RESAMPLING", useSpatialResampling() ? "1" : "0");
+    defines.add("SPATIAL_RADIUS", std::to_string(mStaticParams.mSpatialRadius));
+    defines.add("SPATIAL_NEIGHBORS", std::to_string(mStaticParams.mSpatialNeighbors));
+    defines.add("USE_ALL_LIGHT_SOURCES", mStaticParams.mUseAllLightSources ? "1" : "0");
+    defines.add("USE_ADAPTIVE_LIGHT_SELECTION", useAdaptiveLightSelection() ? "1" : "0");
+    defines.add("USE_LIGHT_ALIAS_TABLE", useLightAliasTable() ? "1" : "0");
+    defines.add("USE_LIGHT_TILES", useLightTiles() ? "1" : "0");
+    defines.add("LIGHT_TILE_SIZE", std::to_string(mStaticParams.mLightTileSize));
+    defines.add("LIGHT_TILE_CAPACITY", std::to_string(mStaticParams.mLightTileCapacity));
+    defines.add("LIGHT_TILE_FALLBACK", std::to_string(mStaticParams.mLightTileFallback));
+    defines.add("USE_PRESAMPLED_LIGHTS", mStaticParams.mUsePresampledLights ? "1" : "0");
+    defines.add("PRESAMPLED_TILE_COUNT", std::to_string(mStaticParams.mPresampledTileCount));
+    defines.add("PRESAMPLED_TILE_SIZE", std::to_string(mStaticParams.mPresampledTileSize));
+    defines.add("USE_VISIBILITY_REUSE", useVisibilityReuse() ? "1" : "0");
+    defines.add("USE_VISIBILITY_CACHE", mStaticParams.mUseVisibilityCache ? "1" : "0");
+    if (mpLightSampling)
+        defines.add(mpLightSampling->getDefines());
 
     return defines;
 }
@@ -268,14 +407,108 @@ void ReSTIRDIPass::prepareResources(RenderContext* pRenderContext, const RenderD
         );
     }
 
+    if (useAdaptiveLightSelection())
+        mpLightSelectionStats->beginFrame(pRenderContext);
+
+    if (useLightAliasTable())
+    {
+        if (!mpLightAliasTable)
+            mpLightAliasTable = LightAliasTable::create(mpDevice);
+        mpLightAliasTable->update(mpScene);
+    }
+
+    FALCOR_ASSERT(mpLightSampling);
+    mpLightSampling->setShaderData(mpParamsBlock->getRootVar());
+}
+
+void ReSTIRDIPass::presampleLights(RenderContext* pRenderContext)
+{
+    if (!mpPresampleLightsPass)
     {
-        auto var = mpParamsBlock->getRootVar();
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kTracePassFile).setShaderModel(kShaderModel).csEntry("presampleLights");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        FALCOR_ASSERT(mpSampleGenerator);
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getDefines());
+
+        mpPresampleLightsPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    FALCOR_ASSERT(mpPresampleLightsPass);
+    mpPresampleLightsPass->getProgram()->addDefines(getDefines());
 
-        if (mpEmissiveSampler)
-            mpEmissiveSampler->setShaderData(var["emissiveSampler"]);
-        if (mpEnvMapSampler)
-            mpEnvMapSampler->setShaderData(var["envMapSampler"]);
+    auto var = mpPresampleLightsPass->getRootVar();
+    const uint32_t lightCount = mStaticParams.mPresampledTileCount * mStaticParams.mPresampledTileSize;
+    if (!mpPresampledLights || mpPresampledLights->getElementCount() != lightCount)
+    {
+        mpPresampledLights = Buffer::createStructured(
+            mpDevice.get(), var["gPresampledLights"], lightCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, nullptr, false
+        );
     }
+    var["gPresampledLights"] = mpPresampledLights;
+
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gLightTypeProbabilities"] = getLightTypeProbabilities();
+    var["gLightAliasTable"] = useLightAliasTable() ? mpLightAliasTable->getBuffer() : nullptr;
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpLightSampling->setShaderData(var["params"]);
+
+    var["gScene"] = mpScene->getParameterBlock();
+    mpSampleGenerator->setShaderData(var);
+    mpPresampleLightsPass->execute(pRenderContext, {lightCount, 1u, 1u});
+}
+
+void ReSTIRDIPass::cullLightTiles(RenderContext* pRenderContext, const Texture::SharedPtr& vBuffer)
+{
+    if (!mpCullLightTilesPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kCullLightTilesFile).setShaderModel(kShaderModel).csEntry("cullLightTiles");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(getDefines());
+
+        mpCullLightTilesPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    FALCOR_ASSERT(mpCullLightTilesPass);
+    mpCullLightTilesPass->getProgram()->addDefines(getDefines());
+
+    const uint2 tileDim = (mFrameDim + mStaticParams.mLightTileSize - 1u) / mStaticParams.mLightTileSize;
+    const uint32_t tileCount = tileDim.x * tileDim.y;
+    const uint32_t entryCount = tileCount * mStaticParams.mLightTileCapacity;
+    if (!mpLightTileCounts || mpLightTileCounts->getElementCount() != tileCount)
+    {
+        mpLightTileCounts = Buffer::createStructured(
+            mpDevice.get(), sizeof(uint32_t), tileCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, nullptr, false
+        );
+    }
+    if (!mpLightTileLists || mpLightTileLists->getElementCount() != entryCount)
+    {
+        mpLightTileLists = Buffer::createStructured(
+            mpDevice.get(), sizeof(uint2), entryCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, nullptr, false
+        );
+    }
+
+    auto var = mpCullLightTilesPass->getRootVar();
+    var["gVBuffer"] = vBuffer;
+    var["gLightTileLists"] = mpLightTileLists;
+    var["gLightTileCounts"] = mpLightTileCounts;
+    var["CB"]["gFrameDim"] = mFrameDim;
+    var["CB"]["gLightTileDim"] = tileDim;
+    var["gScene"] = mpScene->getParameterBlock();
+
+    // One thread group of 16x16 threads per tile.
+    mpCullLightTilesPass->execute(pRenderContext, {tileDim.x * 16, tileDim.y * 16, 1u});
 }
 
 void ReSTIRDIPass::prepareReservoir(
@@ -336,34 +569,53 @@ void ReSTIRDIPass::prepareReservoir(
     var["CB"]["gFrameCount"] = mFrameCount;
     var["CB"]["gFrameDim"] = mFrameDim;
     var["CB"]["isValidViewW"] = viewW == nullptr;
+    var["CB"]["gLightTypeProbabilities"] = getLightTypeProbabilities();
+    var["gLightSelectionStats"] = mpLightSelectionStats->getBuffer();
+    var["gPresampledLights"] = mpPresampledLights;
+    var["gLightAliasTable"] = useLightAliasTable() ? mpLightAliasTable->getBuffer() : nullptr;
+    var["gLightTileLists"] = useLightTiles() ? mpLightTileLists : nullptr;
+    var["gLightTileCounts"] = useLightTiles() ? mpLightTileCounts : nullptr;
+
+    // The cache is only valid if it was written last frame and nothing moved since.
+    const bool useVisibilityCache = useVisibilityReuse() && mStaticParams.mUseVisibilityCache;
+    if (useVisibilityCache)
+    {
+        const uint32_t pixelCount = mFrameDim.x * mFrameDim.y;
+        if (!mpVisibilityCache || mpVisibilityCache->getElementCount() != pixelCount)
+        {
+            mpVisibilityCache = Buffer::createStructured(
+                mpDevice.get(), var["gVisibilityCache"], pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mVisibilityCacheValid = false;
+        }
+        const auto updates = mpScene->getUpdates();
+        for (auto flag : kVisibilityCacheUpdateFlags)
+        {
+            if (is_set(updates, flag))
+                mVisibilityCacheValid = false;
+        }
+    }
+    var["gVisibilityCache"] = mpVisibilityCache;
+    var["CB"]["gVisibilityCacheValid"] = mVisibilityCacheValid;
+    mVisibilityCacheValid = useVisibilityCache;
 
     FALCOR_ASSERT(mpParamsBlock);
     var["params"] = mpParamsBlock;
 
-    {
-        auto paramsVar = var["params"];
-
-        if (mpScene->useEmissiveLights())
-            FALCOR_ASSERT(mpEmissiveSampler);
-        if (mpEmissiveSampler)
-            mpEmissiveSampler->setShaderData(paramsVar["emissiveSampler"]);
-
-        if (mpScene->useEnvLight())
-            FALCOR_ASSERT(mpEnvMapSampler);
-        if (mpEnvMapSampler)
-            mpEnvMapSampler->setShaderData(paramsVar["envMapSampler"]);
-    }
+    mpLightSampling->setShaderData(var["params"]);
 
     var["gScene"] = mpScene->getParameterBlock();
     mpSampleGenerator->setShaderData(var);
+    if (useVisibilityReuse())
+        mpScene->setRaytracingShaderData(pRenderContext, var);
     mpTracePass->execute(pRenderContext, {mFrameDim, 1u});
 }
 
-void ReSTIRDIPass::finalShading(
+Buffer::SharedPtr ReSTIRDIPass::spatialResampling(
     RenderContext* pRenderContext,
     const RenderData& renderData,
     const Texture::SharedPtr& vBuffer,
-    const Texture::SharedPtr& depth,
     const Texture::SharedPtr& viewW
 )
 {
@@ -371,22 +623,97 @@ void ReSTIRDIPass::finalShading(
     {
         Program::Desc desc;
         desc.addShaderModules(mpScene->getShaderModules());
-        desc.addShaderLibrary(kSpatioResamplingFileName).setShaderModel(kShaderModel).csEntry("main");
+        desc.addShaderLibrary(kSpatialResamplingFile).setShaderModel(kShaderModel).csEntry("main");
         desc.addTypeConformances(mpScene->getTypeConformances());
         FALCOR_ASSERT(mpSampleGenerator);
         auto defines = mpScene->getSceneDefines();
         defines.add(mpSampleGenerator->getDefines());
         defines.add(getDefines());
-        defines.add(getValidResourceDefines(kOutputChannels, renderData));
 
         mpSpatialResampling = ComputePass::create(mpDevice, desc, defines, true);
     }
-    mpSpatialResampling->getProgram()->addDefines(getValidResourceDefines(kOutputChannels, renderData));
     mpSpatialResampling->getProgram()->addDefines(getDefines());
     auto var = mpSpatialResampling->getRootVar();
+
+    const uint32_t reservoirCount = mFrameDim.x * mFrameDim.y;
+    for (auto& pBuffer : mpSpatialReservoirs)
+    {
+        if (!pBuffer || pBuffer->getElementCount() != reservoirCount)
+        {
+            pBuffer = Buffer::createStructured(
+                mpDevice.get(), var["gOutReservoir"], reservoirCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+        }
+    }
+    if (!mpNeighborOffsets)
+    {
+        const std::vector<float2> offsets = createNeighborOffsets();
+        mpNeighborOffsets = Buffer::createStructured(
+            mpDevice.get(), sizeof(float2), kNeighborOffsetCount, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None,
+            offsets.data(), false
+        );
+    }
+
+    var["gVBuffer"] = vBuffer;
+    var["gViewW"] = viewW;
+    var["gNormal"] = renderData.getTexture(kInputNormal);
+    var["gNeighborOffsets"] = mpNeighborOffsets;
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gFrameDim"] = mFrameDim;
+    var["CB"]["isValidViewW"] = viewW == nullptr;
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpLightSampling->setShaderData(var["params"]);
+
+    var["gScene"] = mpScene->getParameterBlock();
+    mpSampleGenerator->setShaderData(var);
+
+    // Ping-pong between the two spatial buffers, the first iteration reads the output of the temporal reuse.
     FALCOR_ASSERT(mpIntermediateReservoir);
+    Buffer::SharedPtr pInput = mpIntermediateReservoir;
+    for (uint32_t iteration = 0; iteration < mStaticParams.mSpatialIterations; iteration++)
+    {
+        const Buffer::SharedPtr& pOutput = mpSpatialReservoirs[iteration % 2];
+        var["gInReservoir"] = pInput;
+        var["gOutReservoir"] = pOutput;
+        var["CB"]["gIteration"] = iteration;
+        mpSpatialResampling->execute(pRenderContext, {mFrameDim, 1u});
+        pInput = pOutput;
+    }
+    return pInput;
+}
 
-    var["gIntermediateReservoir"] = mpIntermediateReservoir;
+void ReSTIRDIPass::finalShading(
+    RenderContext* pRenderContext,
+    const RenderData& renderData,
+    const Texture::SharedPtr& vBuffer,
+    const Texture::SharedPtr& depth,
+    const Texture::SharedPtr& viewW,
+    const Buffer::SharedPtr& pReservoir
+)
+{
+    if (!mpFinalShading)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kFinalShadingFile).setShaderModel(kShaderModel).csEntry("main");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+        FALCOR_ASSERT(mpSampleGenerator);
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getDefines());
+        defines.add(getValidResourceDefines(kOutputChannels, renderData));
+
+        mpFinalShading = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    mpFinalShading->getProgram()->addDefines(getValidResourceDefines(kOutputChannels, renderData));
+    mpFinalShading->getProgram()->addDefines(getDefines());
+    auto var = mpFinalShading->getRootVar();
+    FALCOR_ASSERT(pReservoir);
+
+    var["gReservoir"] = pReservoir;
     var["gVBuffer"] = vBuffer;
     var["gDepth"] = depth;
     var["gViewW"] = viewW;
@@ -396,6 +723,11 @@ void ReSTIRDIPass::finalShading(
     var["CB"]["gFrameDim"] = mFrameDim;
     var["CB"]["isValidViewW"] = viewW == nullptr;
 
+    // The reservoirs only hold the light identity, the shading evaluates the environment map pdf again.
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpLightSampling->setShaderData(var["params"]);
+
     var["gScene"] = mpScene->getParameterBlock();
 
     auto bind = [&](const ChannelDesc& channel)
@@ -408,7 +740,7 @@ void ReSTIRDIPass::finalShading(
 
     mpSampleGenerator->setShaderData(var);
     mpScene->setRaytracingShaderData(pRenderContext, var);
-    mpSpatialResampling->execute(pRenderContext, {mFrameDim, 1u});
+    mpFinalShading->execute(pRenderContext, {mFrameDim, 1u});
 }
 
 void ReSTIRDIPass::endFrame(RenderContext* pRenderContext, const RenderData& renderData)
@@ -422,5 +754,83 @@ void ReSTIRDIPass::renderUI(Gui::Widgets& widget)
 {
     bool dirty = false;
     dirty |= widget.checkbox("Enable ReSTIR", mStaticParams.mUseReSTIR);
+    if (mStaticParams.mUseReSTIR)
+    {
+        dirty |= widget.checkbox("Spatial Reuse", mStaticParams.mUseSpatialReuse);
+        if (mStaticParams.mUseSpatialReuse)
+        {
+            dirty |= widget.var("Spatial Radius", mStaticParams.mSpatialRadius, 1u, kMaxSpatialRadius);
+            dirty |= widget.var("Spatial Neighbors", mStaticParams.mSpatialNeighbors, 1u, kMaxSpatialNeighbors);
+            dirty |= widget.var("Spatial Iterations", mStaticParams.mSpatialIterations, 1u, kMaxSpatialIterations);
+            widget.tooltip("Number of spatial reuse passes, each one reusing the reservoirs of the previous one.");
+        }
+    }
+    if (mpLightSampling)
+    {
+        if (Gui::Group samplingGroup = widget.group("Light Samplers"))
+        {
+            dirty |= samplingGroup.checkbox("Refit Light BVH", mStaticParams.mRefitLightBVH);
+            mpLightSampling->renderUI(samplingGroup);
+        }
+    }
+    dirty |= widget.checkbox("All Light Sources", mStaticParams.mUseAllLightSources);
+    widget.tooltip("Draw the candidates from the environment map and the emissive geometry too, not only from the analytic lights.");
+    if (mStaticParams.mUseAllLightSources)
+    {
+        dirty |= widget.checkbox("Adaptive Light Type Selection", mStaticParams.mUseAdaptiveLightSelection);
+        widget.tooltip("Pick the light type of the candidates in proportion to the contribution measured for each type.");
+        if (useAdaptiveLightSelection())
+        {
+            dirty |= widget.var("Light Type Floor", mStaticParams.mLightSelectionFloor, kMinLightSelectionFloor, 1.f / 3.f);
+            const float3 p = getLightTypeProbabilities();
+            widget.text(fmt::format("EnvMap {:.3f}, Emissive {:.3f}, Analytic {:.3f}", p.x, p.y, p.z));
+        }
+    }
+    dirty |= widget.checkbox("Power Proportional Analytic Lights", mStaticParams.mUseLightAliasTable);
+    widget.tooltip("Select the analytic lights with an alias table over their power, rebuilt on the CPU when the lights change.");
+    if (useLightAliasTable())
+    {
+        widget.text(fmt::format(
+            "Alias table: {} lights, {} builds, last {:.3f} ms (CPU)", mpLightAliasTable->getLightCount(),
+            mpLightAliasTable->getBuildCount(), mpLightAliasTable->getBuildTime()
+        ));
+    }
+    if (widget.button("Benchmark Alias Table Build"))
+        mLightAliasBenchmark = LightAliasTable::runBuildBenchmark();
+    for (const auto& result : mLightAliasBenchmark)
+        widget.text(fmt::format("{} lights, {} threads: {:.3f} ms", result.lightCount, result.threadCount, result.buildTime));
+    dirty |= widget.checkbox("Light Tile Lists", mStaticParams.mUseLightTiles);
+    widget.tooltip(
+        "Draw the analytic light candidates from per screen tile lists of the lights which matter most to the tile. "
+        "Culling costs two light evaluations per light and tile, so it scales with light count / tile area. "
+        "Not used with the presampled light tiles."
+    );
+    if (mStaticParams.mUseLightTiles)
+    {
+        dirty |= widget.var("Light Tile Size", mStaticParams.mLightTileSize, kMinLightTileSize, kMaxLightTileSize);
+        dirty |= widget.var("Light Tile Capacity", mStaticParams.mLightTileCapacity, 1u, kMaxLightTileCapacity);
+        dirty |= widget.var("Light Tile Fallback", mStaticParams.mLightTileFallback, kMinLightTileFallback, 1.f);
+        widget.tooltip("Probability of selecting the candidate over all the lights instead of the tile list.");
+    }
+    dirty |= widget.checkbox("Visibility Reuse", mStaticParams.mUseVisibilityReuse);
+    widget.tooltip(
+        "Trace a shadow ray for the sample of the initial RIS and drop it if occluded, before the temporal and spatial reuse. "
+        "Keeps occluded samples out of the reuse, so that shadowed scenes need fewer candidates."
+    );
+    if (mStaticParams.mUseVisibilityReuse)
+    {
+        dirty |= widget.checkbox("Visibility Cache", mStaticParams.mUseVisibilityCache);
+        widget.tooltip("Reuse the shadow ray of the last frame when the scene is static and the pixel picks the same sample again.");
+    }
+    dirty |= widget.checkbox("Presampled Light Tiles", mStaticParams.mUsePresampledLights);
+    widget.tooltip(
+        "Draw the lights into tiles once per frame and let each 16x16 pixel block pick its candidates from one tile. "
+        "Keeps the light data of a block in cache, at the cost of uniform emissive triangle sampling."
+    );
+    if (mStaticParams.mUsePresampledLights)
+    {
+        dirty |= widget.var("Tile Count", mStaticParams.mPresampledTileCount, 1u, kMaxPresampledTileCount);
+        dirty |= widget.var("Tile Size", mStaticParams.mPresampledTileSize, kMinPresampledTileSize, kMaxPresampledTileSize);
+    }
     mOptionsChanged = dirty;
 }
@@ -10,6 +10,9 @@
 #include "Rendering/Lights/EmissivePowerSampler.h"
 #include "Rendering/Lights/EnvMapSampler.h"
 #include "Rendering/Utils/PixelStats.h"
+#include "../Common/LightSamplingService.h"
+#include "../Common/LightSelectionStats.h"
+#include "LightAliasTable.h"
 
 using namespace Falcor;
 
@@ -42,6 +45,9 @@ private:
     void prepareResources(RenderContext* pRenderContext, const RenderData& renderData);
     Program::DefineList getDefines();
 
+    void presampleLights(RenderContext* pRenderContext);
+    void cullLightTiles(RenderContext* pRenderContext, const Texture::SharedPtr& vBuffer);
+
     void prepareReservoir(
         RenderContext* pRenderContext,
         const RenderData& renderData,
@@ -51,32 +57,82 @@ private:
         const Texture::SharedPtr& motionVector
     );
 
+    /** Run the spatial reuse passes on the reservoirs of the temporal reuse.
+        \return The buffer holding the reservoirs of the last iteration.
+    */
+    Buffer::SharedPtr spatialResampling(
+        RenderContext* pRenderContext,
+        const RenderData& renderData,
+        const Texture::SharedPtr& vBuffer,
+        const Texture::SharedPtr& viewW
+    );
+
     void finalShading(
         RenderContext* pRenderContext,
         const RenderData& renderData,
         const Texture::SharedPtr& vBuffer,
         const Texture::SharedPtr& depth,
-        const Texture::SharedPtr& viewW
+        const Texture::SharedPtr& viewW,
+        const Buffer::SharedPtr& pReservoir
     );
 
+    bool useAdaptiveLightSelection() const { return mStaticParams.mUseAdaptiveLightSelection && mStaticParams.mUseAllLightSources; }
+    bool useLightAliasTable() const
+    {
+        return mStaticParams.mUseLightAliasTable && mpScene && mpScene->useAnalyticLights() && mpScene->getActiveLightCount() > 0;
+    }
+    // The presampled light tiles replace the candidate selection which the lists are built for.
+    bool useLightTiles() const
+    {
+        return mStaticParams.mUseLightTiles && !mStaticParams.mUsePresampledLights && mpScene && mpScene->useAnalyticLights() &&
+               mpScene->getActiveLightCount() > 0;
+    }
+    bool useSpatialResampling() const { return mStaticParams.mUseReSTIR && mStaticParams.mUseSpatialReuse; }
+    bool useVisibilityReuse() const { return mStaticParams.mUseVisibilityReuse && mStaticParams.mUseReSTIR; }
+    float3 getLightTypeProbabilities() const
+    {
+        return mpLightSelectionStats->getLightTypeProbabilities(mpScene, mStaticParams.mLightSelectionFloor);
+    }
+
     void endFrame(RenderContext* pRenderContext, const RenderData& renderData);
 
     Scene::SharedPtr mpScene;
     SampleGenerator::SharedPtr mpSampleGenerator;
-    EnvMapSampler::SharedPtr mpEnvMapSampler;
-    EmissiveLightSampler::SharedPtr mpEmissiveSampler;
+    // Emissive and environment map samplers, shared with the other passes of the graph.
+    LightSamplingService::SharedPtr mpLightSampling;
+    // Power proportional selection of the analytic lights, only created when enabled.
+    LightAliasTable::SharedPtr mpLightAliasTable;
+    std::vector<LightAliasTable::BenchmarkResult> mLightAliasBenchmark;
     PixelStats::SharedPtr mpPixelStats;
     PixelDebug::SharedPtr mpPixelDebug;
     ParameterBlock::SharedPtr mpParamsBlock;
 
     ComputePass::SharedPtr mpReflectTypes;
     ComputePass::SharedPtr mpTracePass;
+    ComputePass::SharedPtr mpPresampleLightsPass;
+    ComputePass::SharedPtr mpCullLightTilesPass;
     ComputePass::SharedPtr mpSpatialResampling;
+    ComputePass::SharedPtr mpFinalShading;
 
     Buffer::SharedPtr mpTemporalReservoir;
     Buffer::SharedPtr mpIntermediateReservoir;
+    // Ping-pong buffers of the spatial reuse iterations.
+    Buffer::SharedPtr mpSpatialReservoirs[2];
+    // Low-discrepancy neighbor pattern of the spatial reuse, in the unit disk.
+    Buffer::SharedPtr mpNeighborOffsets;
 
     Texture::SharedPtr mpPrevNormal;
+    // Light tiles drawn by mpPresampleLightsPass, only allocated when presampling is enabled.
+    Buffer::SharedPtr mpPresampledLights;
+    // Analytic light lists and their lengths per screen tile, built by mpCullLightTilesPass.
+    Buffer::SharedPtr mpLightTileLists;
+    Buffer::SharedPtr mpLightTileCounts;
+    // Shadow ray results of the visibility reuse, per pixel. Valid while the camera, the geometry and the lights are static.
+    Buffer::SharedPtr mpVisibilityCache;
+    bool mVisibilityCacheValid = false;
+
+    // Candidate contribution statistics per light type, in EnvMap, Emissive, Analytic order.
+    LightSelectionStats::SharedPtr mpLightSelectionStats;
 
     struct
     {
@@ -88,6 +144,28 @@ private:
         bool mUseSpatialReuse = true;
         uint mSpatialRadius = 5;
         uint mSpatialNeighbors = 4;
+        uint mSpatialIterations = 1;
+        // Draw the candidates from every light type instead of the analytic lights only.
+        bool mUseAllLightSources = false;
+        // Learn the light type selection probabilities from the measured candidate contributions.
+        bool mUseAdaptiveLightSelection = false;
+        float mLightSelectionFloor = 0.05f;
+        // Refit the shared light BVH on emissive changes instead of rebuilding it. The first pass of a frame decides.
+        bool mRefitLightBVH = true;
+        // Pick the candidates from tiles of lights drawn once per frame, shared by 16x16 pixel blocks.
+        bool mUsePresampledLights = false;
+        uint mPresampledTileCount = 128;
+        uint mPresampledTileSize = 1024;
+        // Select the analytic lights in proportion to their power instead of uniformly.
+        bool mUseLightAliasTable = false;
+        // Draw the analytic light candidates from per screen tile light lists, with a fallback to all the lights.
+        bool mUseLightTiles = false;
+        uint mLightTileSize = 16;
+        uint mLightTileCapacity = 32;
+        float mLightTileFallback = 0.1f;
+        // Drop the occluded samples of the initial RIS before the reuse, caching the shadow rays of static pixels.
+        bool mUseVisibilityReuse = false;
+        bool mUseVisibilityCache = true;
     } mStaticParams;
 
     uint2 mFrameDim = uint2(0, 0);
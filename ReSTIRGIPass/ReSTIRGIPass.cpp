@@ -14,6 +14,12 @@ const std::string kInitialSamplingFile = "RenderPasses/ReSTIRGIPass/PrepareReser
 const std::string kTemporalSamplingFile = "RenderPasses/ReSTIRGIPass/TemporalResampling.cs.slang";
 const std::string kSpatialSamplingFile = "RenderPasses/ReSTIRGIPass/SpatialResampling.cs.slang";
 const std::string kFinalShadingFile = "RenderPasses/ReSTIRGIPass/EvaluateSample.cs.slang";
+const std::string kAdaptiveSecondaryRaysFile = "RenderPasses/ReSTIRGIPass/AdaptiveSecondaryRays.cs.slang";
+const std::string kSortSecondaryRaysFile = "RenderPasses/ReSTIRGIPass/SortSecondaryRays.cs.slang";
+const std::string kBinSecondaryHitsFile = "RenderPasses/ReSTIRGIPass/BinSecondaryHits.cs.slang";
+const std::string kRadianceCacheFile = "RenderPasses/ReSTIRGIPass/RadianceCache.cs.slang";
+const std::string kLightGridFile = "RenderPasses/ReSTIRGIPass/BuildLightGrid.cs.slang";
+const std::string kPathGuidingFile = "RenderPasses/ReSTIRGIPass/PathGuiding.cs.slang";
 const std::string kShaderModel = "6_5";
 
 const std::string kInputVBuffer = "vBuffer";
@@ -32,16 +38,63 @@ const std::string kRussianRouletteProbability = "russianRouletteProbability";
 const std::string kUseImportanceSampling = "useImportanceSampling";
 const std::string kUseInfiniteBounces = "useInfiniteBounces";
 const std::string kMaxBounce = "maxBounce";
+const std::string kUseWavefrontPathTracer = "wavefrontPathTracer";
+const std::string kSortSecondaryRays = "sortSecondaryRays";
+const std::string kDeferredSecondaryShading = "deferredSecondaryShading";
 const std::string kExcludeEnvMapEmissiveFromRIS = "analyticOnly";
+const std::string kUseAdaptiveLightSelection = "adaptiveLightSelection";
+const std::string kLightSelectionFloor = "lightSelectionFloor";
+const std::string kRefitLightBVH = "lightBVHRefit";
+const std::string kUseAdaptiveSecondaryRays = "adaptiveSecondaryRays";
+const std::string kAdaptiveMinProbability = "adaptiveMinProbability";
+const std::string kAdaptiveDepthBudget = "adaptiveDepthBudget";
 const std::string kUseHalfResolutionGI = "halfResolution";
+const std::string kInterleavedSamplingRate = "interleavedSamplingRate";
+const std::string kInterleaveWithBlueNoise = "interleaveWithBlueNoise";
 
 const std::string kUseTemporalResampling = "useTemporalResampling";
 const std::string kTemporalReservoirSize = "temporalReservoirSize";
+const std::string kUseSampleValidation = "sampleValidation";
+const std::string kValidationRate = "validationRate";
+const std::string kValidationThreshold = "validationThreshold";
+const std::string kUseMotionVectorReprojection = "motionVectorReprojection";
+const std::string kReprojectionDepthThreshold = "reprojectionDepthThreshold";
+const std::string kReprojectionNormalThreshold = "reprojectionNormalThreshold";
+const std::string kCollectReprojectionStats = "reprojectionStats";
+const std::string kUseScreenSpaceRadianceReuse = "screenSpaceRadianceReuse";
+const std::string kScreenSpaceReuseMinRoughness = "screenSpaceReuseMinRoughness";
+const std::string kUseReservoirGrid = "reservoirGrid";
+const std::string kReservoirGridCellSize = "reservoirGridCellSize";
+const std::string kReservoirGridCapacity = "reservoirGridCapacity";
+
+const std::string kUseRadianceCache = "radianceCache";
+const std::string kRadianceCacheCellSize = "radianceCacheCellSize";
+const std::string kRadianceCacheCapacity = "radianceCacheCapacity";
+const std::string kRadianceCacheSpreadThreshold = "radianceCacheSpreadThreshold";
+const std::string kRadianceCacheMinBounces = "radianceCacheMinBounces";
+const std::string kRadianceCacheUpdateBudget = "radianceCacheUpdateBudget";
+
+const std::string kUseAdaptiveRussianRoulette = "adaptiveRussianRoulette";
+const std::string kMaxNeeSplits = "maxNeeSplits";
+
+const std::string kUseLightGrid = "lightGrid";
+const std::string kLightGridCellBudget = "lightGridCellBudget";
+const std::string kLightGridReservoirs = "lightGridReservoirs";
+const std::string kLightGridCandidates = "lightGridCandidates";
+
+const std::string kUsePathGuiding = "pathGuiding";
+const std::string kPathGuidingProbability = "pathGuidingProbability";
+const std::string kPathGuidingCellSize = "pathGuidingCellSize";
+const std::string kPathGuidingCapacity = "pathGuidingCapacity";
 
 const std::string kUseSpatialResampling = "useSpatialResampling";
 const std::string kSpatialReservoirSize = "spatialReservoirSize";
 const std::string kSpatialResamplingRadius = "spatialResamplingRadius";
 const std::string kSpatialNeighborsCount = "spatialNeighborsCount";
+const std::string kUseSpatialResamplingPass = "spatialResamplingPass";
+const std::string kSpatialIterations = "spatialIterations";
+const std::string kSpatialFarSampleRatio = "spatialFarSampleRatio";
+const std::string kUnbiasedSpatialResampling = "unbiasedSpatialResampling";
 const std::string kDoVisibilityTestEachSamples = "doVisibilityTestEachSamples";
 
 const std::string kEvalDirectLighting = "evalDirectLighting";
@@ -55,7 +108,51 @@ const Falcor::ChannelList kInputChannels = {
     {kInputDirectLighting, "gDirectLighting", "Radiance from Direct Lighting", true},
     {kInputDiffuseReflectance, kDiffuseReflectanceTexName, "Diffuse Reflectance on Visibility Points", true},
     {kInputSpecularReflectance, kSpecularReflectanceTexName, "Specular Reflectance on Visibility Points", true},
-    // {kInputNoise, "gNoiseTex", "Noise Texture", true},
+    {kInputNoise, "gNoiseTex", "Blue Noise Texture for interleaved sampling", true},
+};
+
+const uint32_t kAdaptiveTileSize = 16;
+// Must match PathState in PrepareReservoir.cs.slang.
+const uint32_t kPathStateSize = 72;
+// Must match kRaySortTileSize in StaticParams.slang.
+const uint32_t kRaySortTileSize = 32;
+// Materials beyond this count share bins in the deferred secondary shading mode.
+const uint32_t kMaxHitBins = 4096;
+// Attempts, successes and camera fallback successes of the temporal lookups, see recordReprojection().
+const uint32_t kReprojectionStatsSize = 3 * sizeof(uint32_t);
+// Must match PackedGIReservoir in GIReservoir.slang.
+const uint32_t kPackedReservoirSize = 80;
+// Must match kReservoirGridSlots in StaticParams.slang.
+const uint32_t kReservoirGridSlots = 4;
+// Capacity range of the world-space hash grids, in cells.
+const uint32_t kMinHashGridCapacity = 1u << 12;
+const uint32_t kMaxHashGridCapacity = 1u << 22;
+// Fixed-point radiance sums and sample count per radiance cache cell, see updateRadianceCache().
+const uint32_t kRadianceCacheAccumSize = 4 * sizeof(uint32_t);
+// Light index and contribution weight per light grid reservoir.
+const uint32_t kLightGridReservoirSize = 2 * sizeof(uint32_t);
+const uint32_t kMaxLightGridCells = 1u << 18;
+const float kMinLightSelectionFloor = 0.01f;
+const uint32_t kMaxLightGridReservoirs = 32;
+// Must match kPathGuidingBins in StaticParams.slang.
+const uint32_t kPathGuidingBins = 64;
+// Every path guiding cell holds two histograms, which bounds the capacity well below the other hash grids.
+const uint32_t kMaxPathGuidingCapacity = 1u << 16;
+const float kMaxPathGuidingProbability = 0.95f;
+
+const Gui::DropdownList kInterleavedSamplingRateList = {
+    {1, "1/1"},
+    {2, "1/2"},
+    {4, "1/4"},
+    {8, "1/8"},
+};
+
+const Gui::DropdownList kValidationRateList = {
+    {1, "1/1"},
+    {2, "1/2"},
+    {4, "1/4"},
+    {8, "1/8"},
+    {16, "1/16"},
 };
 
 const Falcor::ChannelList kOutputChannels = {
@@ -67,6 +164,16 @@ const Falcor::ChannelList kOutputChannels = {
     {"specularReflectance", "gSpecularReflectance", "", true, ResourceFormat::RGBA32Float},
 };
 
+/** The hash grids are probed with a mask, so their capacity has to be a power of two.
+*/
+uint32_t clampHashGridCapacity(uint32_t capacity)
+{
+    uint32_t clamped = kMinHashGridCapacity;
+    while (clamped * 2 <= std::min(capacity, kMaxHashGridCapacity))
+        clamped *= 2;
+    return clamped;
+}
+
 } // namespace
 
 extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registry)
@@ -81,6 +188,7 @@ ReSTIRGIPass::ReSTIRGIPass(std::shared_ptr<Device> pDevice, const Dictionary& di
 
     parseDictionary(dict);
     mpSampleGenerator = SampleGenerator::create(mpDevice, SAMPLE_GENERATOR_DEFAULT);
+    mpLightSelectionStats = LightSelectionStats::create(mpDevice);
     if (!mpDevice->isFeatureSupported(Device::SupportedFeatures::RaytracingTier1_1))
         logError("Inline Raytracing is not supported on this device.");
 }
@@ -99,18 +207,61 @@ Dictionary ReSTIRGIPass::getScriptingDictionary()
     d[kUseImportanceSampling] = mStaticParams.mUseImportanceSampling;
     d[kUseInfiniteBounces] = mStaticParams.mUseInfiniteBounces;
     d[kMaxBounce] = mStaticParams.mMaxBounces;
+    d[kUseWavefrontPathTracer] = mStaticParams.mUseWavefrontPathTracer;
+    d[kSortSecondaryRays] = mStaticParams.mSortSecondaryRays;
+    d[kDeferredSecondaryShading] = mStaticParams.mDeferredSecondaryShading;
+    d[kUseAdaptiveSecondaryRays] = mStaticParams.mUseAdaptiveSecondaryRays;
+    d[kAdaptiveMinProbability] = mStaticParams.mAdaptiveMinProbability;
+    d[kAdaptiveDepthBudget] = mStaticParams.mAdaptiveDepthBudget;
     d[kUseTemporalResampling] = mStaticParams.mTemporalResampling;
     d[kTemporalReservoirSize] = mStaticParams.mTemporalReservoirSize;
+    d[kUseSampleValidation] = mStaticParams.mUseSampleValidation;
+    d[kValidationRate] = mStaticParams.mValidationRate;
+    d[kValidationThreshold] = mStaticParams.mValidationThreshold;
+    d[kUseMotionVectorReprojection] = mStaticParams.mUseMotionVectorReprojection;
+    d[kReprojectionDepthThreshold] = mStaticParams.mReprojectionDepthThreshold;
+    d[kReprojectionNormalThreshold] = mStaticParams.mReprojectionNormalThreshold;
+    d[kCollectReprojectionStats] = mStaticParams.mCollectReprojectionStats;
+    d[kUseScreenSpaceRadianceReuse] = mStaticParams.mUseScreenSpaceRadianceReuse;
+    d[kScreenSpaceReuseMinRoughness] = mStaticParams.mScreenSpaceReuseMinRoughness;
+    d[kUseReservoirGrid] = mStaticParams.mUseReservoirGrid;
+    d[kReservoirGridCellSize] = mStaticParams.mReservoirGridCellSize;
+    d[kReservoirGridCapacity] = mStaticParams.mReservoirGridCapacity;
+    d[kUseRadianceCache] = mStaticParams.mUseRadianceCache;
+    d[kRadianceCacheCellSize] = mStaticParams.mRadianceCacheCellSize;
+    d[kRadianceCacheCapacity] = mStaticParams.mRadianceCacheCapacity;
+    d[kRadianceCacheSpreadThreshold] = mStaticParams.mRadianceCacheSpreadThreshold;
+    d[kRadianceCacheMinBounces] = mStaticParams.mRadianceCacheMinBounces;
+    d[kRadianceCacheUpdateBudget] = mStaticParams.mRadianceCacheUpdateBudget;
+    d[kUseAdaptiveRussianRoulette] = mStaticParams.mUseAdaptiveRussianRoulette;
+    d[kMaxNeeSplits] = mStaticParams.mMaxNeeSplits;
+    d[kUseLightGrid] = mStaticParams.mUseLightGrid;
+    d[kLightGridCellBudget] = mStaticParams.mLightGridCellBudget;
+    d[kLightGridReservoirs] = mStaticParams.mLightGridReservoirs;
+    d[kLightGridCandidates] = mStaticParams.mLightGridCandidates;
+    d[kUsePathGuiding] = mStaticParams.mUsePathGuiding;
+    d[kPathGuidingProbability] = mStaticParams.mPathGuidingProbability;
+    d[kPathGuidingCellSize] = mStaticParams.mPathGuidingCellSize;
+    d[kPathGuidingCapacity] = mStaticParams.mPathGuidingCapacity;
     d[kUseSpatialResampling] = mStaticParams.mSpatialResampling;
     d[kSpatialReservoirSize] = mStaticParams.mSpatialReservoirSize;
     d[kSpatialResamplingRadius] = mStaticParams.mSampleRadius;
     d[kSpatialNeighborsCount] = mStaticParams.mSpatialNeighborsCount;
+    d[kUseSpatialResamplingPass] = mStaticParams.mUseSpatialResamplingPass;
+    d[kSpatialIterations] = mStaticParams.mSpatialIterations;
+    d[kSpatialFarSampleRatio] = mStaticParams.mSpatialFarSampleRatio;
+    d[kUnbiasedSpatialResampling] = mStaticParams.mUnbiasedSpatialResampling;
     d[kDoVisibilityTestEachSamples] = mStaticParams.mDoVisibilityTestEachSamples;
     d[kEvalDirectLighting] = mStaticParams.mEvalDirect;
     d[kShowVisibilityPointLi] = mStaticParams.mShowVisibilityPointLi;
     d[kSplitView] = mStaticParams.mSplitView;
     d[kExcludeEnvMapEmissiveFromRIS] = mStaticParams.mExcludeEnvMapEmissiveFromRIS;
+    d[kUseAdaptiveLightSelection] = mStaticParams.mUseAdaptiveLightSelection;
+    d[kLightSelectionFloor] = mStaticParams.mLightSelectionFloor;
+    d[kRefitLightBVH] = mStaticParams.mRefitLightBVH;
     d[kUseHalfResolutionGI] = mStaticParams.mUseHalfResolutionGI;
+    d[kInterleavedSamplingRate] = mStaticParams.mInterleavedSamplingRate;
+    d[kInterleaveWithBlueNoise] = mStaticParams.mInterleaveWithBlueNoise;
 
     return d;
 }
@@ -139,6 +290,30 @@ void ReSTIRGIPass::parseDictionary(const Dictionary& dict)
         {
             mStaticParams.mMaxBounces = v;
         }
+        else if (k == kUseWavefrontPathTracer)
+        {
+            mStaticParams.mUseWavefrontPathTracer = v;
+        }
+        else if (k == kSortSecondaryRays)
+        {
+            mStaticParams.mSortSecondaryRays = v;
+        }
+        else if (k == kDeferredSecondaryShading)
+        {
+            mStaticParams.mDeferredSecondaryShading = v;
+        }
+        else if (k == kUseAdaptiveSecondaryRays)
+        {
+            mStaticParams.mUseAdaptiveSecondaryRays = v;
+        }
+        else if (k == kAdaptiveMinProbability)
+        {
+            mStaticParams.mAdaptiveMinProbability = v;
+        }
+        else if (k == kAdaptiveDepthBudget)
+        {
+            mStaticParams.mAdaptiveDepthBudget = v;
+        }
         else if (k == kUseTemporalResampling)
         {
             mStaticParams.mTemporalResampling = v;
@@ -147,6 +322,118 @@ void ReSTIRGIPass::parseDictionary(const Dictionary& dict)
         {
             mStaticParams.mTemporalReservoirSize = v;
         }
+        else if (k == kUseSampleValidation)
+        {
+            mStaticParams.mUseSampleValidation = v;
+        }
+        else if (k == kValidationRate)
+        {
+            mStaticParams.mValidationRate = v;
+        }
+        else if (k == kValidationThreshold)
+        {
+            mStaticParams.mValidationThreshold = v;
+        }
+        else if (k == kUseMotionVectorReprojection)
+        {
+            mStaticParams.mUseMotionVectorReprojection = v;
+        }
+        else if (k == kReprojectionDepthThreshold)
+        {
+            mStaticParams.mReprojectionDepthThreshold = v;
+        }
+        else if (k == kReprojectionNormalThreshold)
+        {
+            mStaticParams.mReprojectionNormalThreshold = v;
+        }
+        else if (k == kCollectReprojectionStats)
+        {
+            mStaticParams.mCollectReprojectionStats = v;
+        }
+        else if (k == kUseScreenSpaceRadianceReuse)
+        {
+            mStaticParams.mUseScreenSpaceRadianceReuse = v;
+        }
+        else if (k == kScreenSpaceReuseMinRoughness)
+        {
+            mStaticParams.mScreenSpaceReuseMinRoughness = v;
+        }
+        else if (k == kUseReservoirGrid)
+        {
+            mStaticParams.mUseReservoirGrid = v;
+        }
+        else if (k == kReservoirGridCellSize)
+        {
+            mStaticParams.mReservoirGridCellSize = v;
+        }
+        else if (k == kReservoirGridCapacity)
+        {
+            mStaticParams.mReservoirGridCapacity = v;
+        }
+        else if (k == kUseRadianceCache)
+        {
+            mStaticParams.mUseRadianceCache = v;
+        }
+        else if (k == kRadianceCacheCellSize)
+        {
+            mStaticParams.mRadianceCacheCellSize = v;
+        }
+        else if (k == kRadianceCacheCapacity)
+        {
+            mStaticParams.mRadianceCacheCapacity = v;
+        }
+        else if (k == kRadianceCacheSpreadThreshold)
+        {
+            mStaticParams.mRadianceCacheSpreadThreshold = v;
+        }
+        else if (k == kRadianceCacheMinBounces)
+        {
+            mStaticParams.mRadianceCacheMinBounces = v;
+        }
+        else if (k == kRadianceCacheUpdateBudget)
+        {
+            mStaticParams.mRadianceCacheUpdateBudget = v;
+        }
+        else if (k == kUseAdaptiveRussianRoulette)
+        {
+            mStaticParams.mUseAdaptiveRussianRoulette = v;
+        }
+        else if (k == kMaxNeeSplits)
+        {
+            mStaticParams.mMaxNeeSplits = v;
+        }
+        else if (k == kUseLightGrid)
+        {
+            mStaticParams.mUseLightGrid = v;
+        }
+        else if (k == kLightGridCellBudget)
+        {
+            mStaticParams.mLightGridCellBudget = v;
+        }
+        else if (k == kLightGridReservoirs)
+        {
+            mStaticParams.mLightGridReservoirs = v;
+        }
+        else if (k == kLightGridCandidates)
+        {
+            mStaticParams.mLightGridCandidates = v;
+        }
+        else if (k == kUsePathGuiding)
+        {
+            mStaticParams.mUsePathGuiding = v;
+        }
+        else if (k == kPathGuidingProbability)
+        {
+            mStaticParams.mPathGuidingProbability = v;
+        }
+        else if (k == kPathGuidingCellSize)
+        {
+            mStaticParams.mPathGuidingCellSize = v;
+        }
+        else if (k == kPathGuidingCapacity)
+        {
+            mStaticParams.mPathGuidingCapacity = v;
+        }
         else if (k == kUseSpatialResampling)
         {
             mStaticParams.mSpatialResampling = v;
@@ -163,6 +450,22 @@ void ReSTIRGIPass::parseDictionary(const Dictionary& dict)
         {
             mStaticParams.mSpatialNeighborsCount = v;
         }
+        else if (k == kUseSpatialResamplingPass)
+        {
+            mStaticParams.mUseSpatialResamplingPass = v;
+        }
+        else if (k == kSpatialIterations)
+        {
+            mStaticParams.mSpatialIterations = v;
+        }
+        else if (k == kSpatialFarSampleRatio)
+        {
+            mStaticParams.mSpatialFarSampleRatio = v;
+        }
+        else if (k == kUnbiasedSpatialResampling)
+        {
+            mStaticParams.mUnbiasedSpatialResampling = v;
+        }
         else if (k == kDoVisibilityTestEachSamples)
         {
             mStaticParams.mDoVisibilityTestEachSamples = v;
@@ -183,11 +486,66 @@ void ReSTIRGIPass::parseDictionary(const Dictionary& dict)
         {
             mStaticParams.mExcludeEnvMapEmissiveFromRIS = v;
         }
+        else if (k == kUseAdaptiveLightSelection)
+        {
+            mStaticParams.mUseAdaptiveLightSelection = v;
+        }
+        else if (k == kLightSelectionFloor)
+        {
+            mStaticParams.mLightSelectionFloor = v;
+        }
+        else if (k == kRefitLightBVH)
+        {
+            mStaticParams.mRefitLightBVH = v;
+        }
         else if (k == kUseHalfResolutionGI)
         {
             mStaticParams.mUseHalfResolutionGI = v;
         }
+        else if (k == kInterleavedSamplingRate)
+        {
+            mStaticParams.mInterleavedSamplingRate = v;
+        }
+        else if (k == kInterleaveWithBlueNoise)
+        {
+            mStaticParams.mInterleaveWithBlueNoise = v;
+        }
     }
+
+    // The interleaving pattern is built from a 4x4 Bayer matrix, so the rate has to divide 16.
+    uint rate = std::clamp(mStaticParams.mInterleavedSamplingRate, 1u, 8u);
+    while (16u % rate != 0)
+        rate--;
+    mStaticParams.mInterleavedSamplingRate = rate;
+    mStaticParams.mSpatialIterations = std::clamp(mStaticParams.mSpatialIterations, 1u, 4u);
+    // The validation pattern is a strided lattice, so the rate has to be a power of two up to 16.
+    uint validationRate = 1;
+    while (validationRate * 2 <= std::min(mStaticParams.mValidationRate, 16u))
+        validationRate *= 2;
+    mStaticParams.mValidationRate = validationRate;
+    mStaticParams.mSpatialFarSampleRatio = std::clamp(mStaticParams.mSpatialFarSampleRatio, 0.f, 1.f);
+    mStaticParams.mAdaptiveDepthBudget = std::clamp(mStaticParams.mAdaptiveDepthBudget, 0.f, 1.f);
+    mStaticParams.mReprojectionDepthThreshold = std::max(mStaticParams.mReprojectionDepthThreshold, 0.f);
+    mStaticParams.mReprojectionNormalThreshold = std::clamp(mStaticParams.mReprojectionNormalThreshold, -1.f, 1.f);
+    mStaticParams.mScreenSpaceReuseMinRoughness = std::clamp(mStaticParams.mScreenSpaceReuseMinRoughness, 0.f, 1.f);
+    mStaticParams.mReservoirGridCellSize = std::max(mStaticParams.mReservoirGridCellSize, 1e-3f);
+    mStaticParams.mReservoirGridCapacity = clampHashGridCapacity(mStaticParams.mReservoirGridCapacity);
+    mStaticParams.mRadianceCacheCellSize = std::max(mStaticParams.mRadianceCacheCellSize, 1e-3f);
+    mStaticParams.mRadianceCacheCapacity = clampHashGridCapacity(mStaticParams.mRadianceCacheCapacity);
+    mStaticParams.mRadianceCacheSpreadThreshold = std::max(mStaticParams.mRadianceCacheSpreadThreshold, 0.f);
+    // The cached radiance includes the emission, which the path only adds from the second bounce on.
+    mStaticParams.mRadianceCacheMinBounces = std::max(mStaticParams.mRadianceCacheMinBounces, 1u);
+    mStaticParams.mMaxNeeSplits = std::clamp(mStaticParams.mMaxNeeSplits, 1u, 16u);
+    // The grid is built with one thread per reservoir, which has to fit in a single dispatch.
+    mStaticParams.mLightGridCellBudget = std::clamp(mStaticParams.mLightGridCellBudget, 1u, kMaxLightGridCells);
+    mStaticParams.mLightGridReservoirs = std::clamp(mStaticParams.mLightGridReservoirs, 1u, kMaxLightGridReservoirs);
+    mStaticParams.mLightGridCandidates = std::clamp(mStaticParams.mLightGridCandidates, 1u, 64u);
+    // The BSDF technique has to keep a share of the samples for the delta lobes.
+    mStaticParams.mPathGuidingProbability = std::clamp(mStaticParams.mPathGuidingProbability, 0.f, kMaxPathGuidingProbability);
+    mStaticParams.mPathGuidingCellSize = std::max(mStaticParams.mPathGuidingCellSize, 1e-3f);
+    mStaticParams.mPathGuidingCapacity = std::min(clampHashGridCapacity(mStaticParams.mPathGuidingCapacity), kMaxPathGuidingCapacity);
+    // Every used light type keeps a non-zero probability, otherwise the estimate is biased.
+    mStaticParams.mLightSelectionFloor = std::clamp(mStaticParams.mLightSelectionFloor, kMinLightSelectionFloor, 1.f / 3.f);
 }
 
 RenderPassReflection ReSTIRGIPass::reflect(const CompileData& compileData)
@@ -202,12 +560,38 @@ RenderPassReflection ReSTIRGIPass::reflect(const CompileData& compileData)
 void ReSTIRGIPass::setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene)
 {
     mFrameCount = 0;
+    if (mpReprojectionStats)
+        mpReprojectionStats->reset();
+    mpLightSelectionStats->reset();
+    mpPrevGeometry = nullptr;
+    mpCurrGeometry = nullptr;
+    mpPrevRadiance = nullptr;
+    mpCurrRadiance = nullptr;
+    mpReservoirGridKeys = nullptr;
+    mpRadianceCacheKeys = nullptr;
     mpScene = pScene;
     mpReflectTypes = nullptr;
     mpInitialSamplingPass = nullptr;
     mpTemporalResamplingPass = nullptr;
     mpSpatialResamplingPass = nullptr;
+    mpValidationPass = nullptr;
     mpFinalShadingPass = nullptr;
+    mpBounceArgsPass = nullptr;
+    mpWavefrontBouncePass = nullptr;
+    mpSortRaysPass = nullptr;
+    mpTraceSortedRaysPass = nullptr;
+    mpCountHitsPass = nullptr;
+    mpScanHitBinsPass = nullptr;
+    mpScatterHitsPass = nullptr;
+    mpShadeSecondaryHitsPass = nullptr;
+    mpTileStatisticsPass = nullptr;
+    mpLaunchProbabilityPass = nullptr;
+    mpResolveRadianceCachePass = nullptr;
+    mpBuildLightGridPass = nullptr;
+    mpLightGridReservoirs = nullptr;
+    mpResolvePathGuidingPass = nullptr;
+    mpPathGuidingKeys = nullptr;
+    mpLightSampling = nullptr;
     if (mpScene)
     {
     }
@@ -236,61 +620,42 @@ void ReSTIRGIPass::execute(RenderContext* pRenderContext, const RenderData& rend
         mOptionsChanged = false;
     }
 
-    bool lightingChanged = false;
-
-    if (mpScene->getRenderSettings().useEmissiveLights)
-    {
-        mpScene->getLightCollection(pRenderContext);
-    }
-
-    if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::RenderSettingsChanged))
-    {
-        lightingChanged = true;
-    }
-
-    if (mpScene->useEmissiveLights())
-    {
-        if (!mpEmissiveLightSampler)
-        {
-            const auto& pLights = mpScene->getLightCollection(pRenderContext);
-            FALCOR_ASSERT(pLights && pLights->getActiveLightCount(pRenderContext) > 0);
-            FALCOR_ASSERT(!mpEmissiveLightSampler);
-            mpEmissiveLightSampler = LightBVHSampler::create(pRenderContext, mpScene);
-            lightingChanged = true;
-        }
-    }
-    else
-    {
-        mpEmissiveLightSampler = nullptr;
-        lightingChanged = true;
-        // TODO
-    }
-
-    if (mpScene->useEnvLight())
-    {
-        if (!mpEnvMapSampler)
-        {
-            mpEnvMapSampler = EnvMapSampler::create(mpDevice, mpScene->getEnvMap());
-            lightingChanged = true;
-            //
-        }
-    }
-    else
-    {
-        mpEnvMapSampler = nullptr;
-        lightingChanged = true;
-        // TODO
-    }
-    if (mpEmissiveLightSampler)
-    {
-        mpEmissiveLightSampler->update(pRenderContext);
-    }
+    // The light samplers are shared with the other passes of the graph and updated once per frame.
+    LightSamplingService::Options lightSamplingOptions;
+    lightSamplingOptions.refitLightBVH = mStaticParams.mRefitLightBVH;
+    mpLightSampling = LightSamplingService::acquire(mpDevice, pRenderContext, mpScene, dict, this, lightSamplingOptions);
 
     prepareResources(pRenderContext, renderData);
+    if (useLightGrid())
+        buildLightGrid(pRenderContext, renderData);
+    if (useSampleValidation())
+        validateSamples(pRenderContext, renderData);
     initialSampling(pRenderContext, renderData, pVBuffer, pDepth, pMVec);
+    if (useSortedSecondaryRays())
+        traceSortedSecondaryRays(pRenderContext, renderData);
+    if (useDeferredSecondaryShading())
+        shadeSecondaryHits(pRenderContext, renderData);
+    if (useWavefrontPathTracer())
+        wavefrontBounces(pRenderContext, renderData);
     if (mStaticParams.mUseHalfResolutionGI)
         temporalResamplingHalfRes(pRenderContext, renderData);
+    else if (mStaticParams.mUseAdaptiveSecondaryRays)
+        updateSecondaryRayBudget(pRenderContext, renderData);
+    if (useRadianceCache())
+        resolveRadianceCache(pRenderContext, renderData);
+    if (usePathGuiding())
+        resolvePathGuiding(pRenderContext, renderData);
+    if (useSpatialResamplingPass())
+        spatialResampling(pRenderContext, renderData);
     finalShading(pRenderContext, renderData, pVBuffer, pDepth);
+    if (collectReprojectionStats())
+        mpReprojectionStats->endFrame(pRenderContext);
+    else if (mpReprojectionStats)
+        mpReprojectionStats->reset();
+    if (useAdaptiveLightSelection())
+        mpLightSelectionStats->endFrame(pRenderContext);
+    else
+        mpLightSelectionStats->reset();
     endFrame();
 }
 
@@ -303,19 +668,56 @@ Program::DefineList ReSTIRGIPass::getStaticDefines(const RenderData& renderData)
     defines.add("USE_ENVLIGHT", mpScene->useEnvLight() ? "1" : "0");
     defines.add("USE_EMISSIVE_LIGHTS", mpScene->useEmissiveLights() ? "1" : "0");
     defines.add("USE_ANALYTIC_LIGHTS", mpScene->useAnalyticLights() ? "1" : "0");
+    defines.add("USE_ADAPTIVE_LIGHT_SELECTION", useAdaptiveLightSelection() ? "1" : "0");
     defines.add("USE_INFINITE_BOUNCES", mStaticParams.mUseInfiniteBounces ? "1" : "0");
     defines.add("MAX_BOUNCES", std::to_string(mStaticParams.mMaxBounces));
+    defines.add("USE_WAVEFRONT_PATH_TRACER", useWavefrontPathTracer() ? "1" : "0");
+    defines.add("SORT_SECONDARY_RAYS", useSortedSecondaryRays() ? "1" : "0");
+    defines.add("DEFERRED_SECONDARY_SHADING", useDeferredSecondaryShading() ? "1" : "0");
+    defines.add(
+        "USE_ADAPTIVE_SECONDARY_RAYS", mStaticParams.mUseAdaptiveSecondaryRays && !mStaticParams.mUseHalfResolutionGI ? "1" : "0"
+    );
     defines.add("EXCLUDE_ENV_AND_EMISSIVE_FROM_RIS", mStaticParams.mExcludeEnvMapEmissiveFromRIS ? "1" : "0");
     defines.add("USE_HARF_RESOLUTION", mStaticParams.mUseHalfResolutionGI ? "1" : "0");
+    defines.add("INTERLEAVED_SAMPLING_RATE", std::to_string(mStaticParams.mUseHalfResolutionGI ? 1u : mStaticParams.mInterleavedSamplingRate));
+    const bool useBlueNoise = mStaticParams.mInterleaveWithBlueNoise && renderData.getTexture(kInputNoise) != nullptr;
+    defines.add("INTERLEAVE_WITH_BLUE_NOISE", useBlueNoise ? "1" : "0");
 
     defines.add("USE_TEMPORAL_RESAMPLING", mStaticParams.mTemporalResampling ? "1" : "0");
     defines.add("TEMPORAL_RESERVOIR_SIZE", std::to_string(mStaticParams.mTemporalReservoirSize));
+    defines.add("VALIDATION_THRESHOLD", std::to_string(mStaticParams.mValidationThreshold));
+    defines.add("USE_MOTION_VECTOR_REPROJECTION", useMotionVectorReprojection() ? "1" : "0");
+    defines.add("REPROJECTION_DEPTH_THRESHOLD", std::to_string(mStaticParams.mReprojectionDepthThreshold));
+    defines.add("REPROJECTION_NORMAL_THRESHOLD", std::to_string(mStaticParams.mReprojectionNormalThreshold));
+    defines.add("COLLECT_REPROJECTION_STATS", collectReprojectionStats() ? "1" : "0");
+    defines.add("USE_SCREEN_SPACE_RADIANCE_REUSE", useScreenSpaceRadianceReuse() ? "1" : "0");
+    defines.add("SCREEN_SPACE_REUSE_MIN_ROUGHNESS", std::to_string(mStaticParams.mScreenSpaceReuseMinRoughness));
+    defines.add("USE_RESERVOIR_GRID", useReservoirGrid() ? "1" : "0");
+    defines.add("RESERVOIR_GRID_CAPACITY", std::to_string(mStaticParams.mReservoirGridCapacity));
+    defines.add("RESERVOIR_GRID_CELL_SIZE", std::to_string(mStaticParams.mReservoirGridCellSize));
+    defines.add("USE_RADIANCE_CACHE", useRadianceCache() ? "1" : "0");
+    defines.add("RADIANCE_CACHE_CAPACITY", std::to_string(mStaticParams.mRadianceCacheCapacity));
+    defines.add("RADIANCE_CACHE_CELL_SIZE", std::to_string(mStaticParams.mRadianceCacheCellSize));
+    defines.add("RADIANCE_CACHE_SPREAD_THRESHOLD", std::to_string(mStaticParams.mRadianceCacheSpreadThreshold));
+    defines.add("RADIANCE_CACHE_MIN_BOUNCES", std::to_string(mStaticParams.mRadianceCacheMinBounces));
+    defines.add("USE_ADAPTIVE_RUSSIAN_ROULETTE", useAdaptiveRussianRoulette() ? "1" : "0");
+    defines.add("MAX_NEE_SPLITS", std::to_string(mStaticParams.mMaxNeeSplits));
+    defines.add("USE_LIGHT_GRID", useLightGrid() ? "1" : "0");
+    defines.add("LIGHT_GRID_RESERVOIRS", std::to_string(mStaticParams.mLightGridReservoirs));
+    defines.add("LIGHT_GRID_CANDIDATES", std::to_string(mStaticParams.mLightGridCandidates));
+    defines.add("USE_PATH_GUIDING", usePathGuiding() ? "1" : "0");
+    defines.add("PATH_GUIDING_PROBABILITY", std::to_string(mStaticParams.mPathGuidingProbability));
+    defines.add("PATH_GUIDING_CAPACITY", std::to_string(mStaticParams.mPathGuidingCapacity));
+    defines.add("PATH_GUIDING_CELL_SIZE", std::to_string(mStaticParams.mPathGuidingCellSize));
     defines.add("USE_SPATIAL_RESAMPLING", mStaticParams.mSpatialResampling ? "1" : "0");
     //    defines.add("USE_MIS", mStaticParams.mUseMIS?"1":"0");
     defines.add("SPATIAL_NEIGHBORHOOD_COUNTS", std::to_string(mStaticParams.mSpatialNeighborsCount));
     defines.add("SPATIAL_RESAMPLING_RADIUS", std::to_string(mStaticParams.mSampleRadius));
     defines.add("SPATIAL_RESERVOIR_SIZE", std::to_string(mStaticParams.mSpatialReservoirSize));
     defines.add("DO_VISIBILITY_TEST_EACH_SAMPLES", mStaticParams.mDoVisibilityTestEachSamples ? "1" : "0");
+    defines.add("USE_SPATIAL_RESAMPLING_PASS", useSpatialResamplingPass() ? "1" : "0");
+    defines.add("SPATIAL_FAR_SAMPLE_RATIO", std::to_string(mStaticParams.mSpatialFarSampleRatio));
+    defines.add("USE_UNBIASED_SPATIAL_RESAMPLING", useSpatialResamplingPass() && mStaticParams.mUnbiasedSpatialResampling ? "1" : "0");
 
     defines.add("EVAL_DIRECT", mStaticParams.mEvalDirect ? "1" : "0");
     defines.add("SHOW_VISIBILITY_POINT_LI", mStaticParams.mShowVisibilityPointLi ? "1" : "0");
@@ -325,8 +727,8 @@ Program::DefineList ReSTIRGIPass::getStaticDefines(const RenderData& renderData)
     const auto& directLighting = renderData.getTexture(kInputDirectLighting);
     const bool readyDirectLighting = (directLighting != nullptr) && (specularReflectance != nullptr) && (diffuseReflectance != nullptr);
     defines.add("READY_REFLECTANCE", readyDirectLighting ? "1" : "0");
-    if (mpEmissiveLightSampler)
-        defines.add(mpEmissiveLightSampler->getDefines());
+    if (mpLightSampling)
+        defines.add(mpLightSampling->getDefines());
     // if (mpScene)
     //     defines.add(mpScene->getSceneDefines());
     return defines;
@@ -356,13 +758,24 @@ void ReSTIRGIPass::prepareResources(RenderContext* pRenderContext, const RenderD
         FALCOR_ASSERT(mpParamsBlock);
     }
 
-    {
-        auto var = mpParamsBlock->getRootVar();
+    FALCOR_ASSERT(mpLightSampling);
+    mpLightSampling->setShaderData(mpParamsBlock->getRootVar());
 
-        if (mpEmissiveLightSampler)
-            mpEmissiveLightSampler->setShaderData(var["emissiveSampler"]);
-        if (mpEnvMapSampler)
-            mpEnvMapSampler->setShaderData(var["envMapSampler"]);
+    const uint2 tileDim = (mFrameDim + kAdaptiveTileSize - 1u) / kAdaptiveTileSize;
+    if (!mpTileSecondaryParams || tileDim.x != mTileDim.x || tileDim.y != mTileDim.y)
+    {
+        mTileDim = tileDim;
+        const uint32_t tileCount = mTileDim.x * mTileDim.y;
+        // Start from the uniform budget until the first statistics are available.
+        std::vector<float2> initialParams(tileCount, float2(mStaticParams.mSecondaryRayLaunchProbability, mStaticParams.mAdaptiveDepthBudget));
+        mpTileSecondaryParams = Buffer::createStructured(
+            mpDevice.get(), sizeof(float2), tileCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, initialParams.data(), false
+        );
+        mpTileStatistics = Buffer::createStructured(
+            mpDevice.get(), sizeof(float2), tileCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, nullptr, false
+        );
     }
 }
 
@@ -414,38 +827,680 @@ void ReSTIRGIPass::initialSampling(
         );
     }
 
-    var["gTemporalReservoirs"] = mpTemporalReservoirs;
-    var["gIntermediateReservoirs"] = mpIntermediateReservoirs;
+    if (useWavefrontPathTracer())
+    {
+        const uint32_t pixelCount = mFrameDim.x * mFrameDim.y;
+        if (!mpInitialSamples || mpInitialSamples->getElementCount() != pixelCount)
+        {
+            mpInitialSamples = Buffer::createStructured(
+                mpDevice.get(), var["gInitialSamples"], pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            // Every pixel owns at most one path, so a queue of pixelCount entries never overflows.
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                mpPathQueues[i] = Buffer::createStructured(
+                    mpDevice.get(), kPathStateSize, pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                    Buffer::CpuAccess::None, nullptr, false
+                );
+                mpPathQueueCounters[i] = Buffer::create(
+                    mpDevice.get(), sizeof(uint32_t), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                    Buffer::CpuAccess::None, nullptr
+                );
+            }
+            mpBounceDispatchArgs = Buffer::create(
+                mpDevice.get(), sizeof(uint32_t) * 3, ResourceBindFlags::UnorderedAccess | ResourceBindFlags::IndirectArg,
+                Buffer::CpuAccess::None, nullptr
+            );
+        }
+        pRenderContext->clearUAV(mpPathQueueCounters[0]->getUAV().get(), uint4(0));
+        var["gInitialSamples"] = mpInitialSamples;
+        var["gPathQueueOut"] = mpPathQueues[0];
+        var["gPathCountOut"] = mpPathQueueCounters[0];
+    }
+    else
+    {
+        mpInitialSamples = nullptr;
+        mpPathQueues[0] = mpPathQueues[1] = nullptr;
+        mpPathQueueCounters[0] = mpPathQueueCounters[1] = nullptr;
+        mpBounceDispatchArgs = nullptr;
+    }
+
+    if (useSortedSecondaryRays() || useDeferredSecondaryShading())
+    {
+        const uint32_t pixelCount = mFrameDim.x * mFrameDim.y;
+        const uint2 sortTileDim = (mFrameDim + kRaySortTileSize - 1u) / kRaySortTileSize;
+        const uint32_t orderCount = sortTileDim.x * sortTileDim.y * kRaySortTileSize * kRaySortTileSize;
+        if (!mpSecondaryRays || mpSecondaryRays->getElementCount() != pixelCount)
+        {
+            mpSecondaryRays = Buffer::createStructured(
+                mpDevice.get(), var["gSecondaryRays"], pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpSecondaryRayKeys = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+        }
+        if (!mpSecondaryRayOrder || mpSecondaryRayOrder->getElementCount() != orderCount)
+        {
+            mpSecondaryRayOrder = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), orderCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+        }
+        var["gSecondaryRays"] = mpSecondaryRays;
+        var["gSecondaryRayKeys"] = mpSecondaryRayKeys;
+    }
+    else
+    {
+        mpSecondaryRays = nullptr;
+        mpSecondaryRayKeys = nullptr;
+        mpSecondaryRayOrder = nullptr;
+    }
+
+    if (useDeferredSecondaryShading())
+    {
+        const uint32_t pixelCount = mFrameDim.x * mFrameDim.y;
+        if (!mpSecondaryHits || mpSecondaryHits->getElementCount() != pixelCount)
+        {
+            mpSecondaryHits = Buffer::createStructured(
+                mpDevice.get(), var["gSecondaryHits"], pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpHitBinKeys = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpShadeOrder = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), pixelCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+        }
+        if (!mpHitBinCounters)
+        {
+            mpHitBinCounters = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), kMaxHitBins, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpDeferredHitCount = Buffer::create(
+                mpDevice.get(), sizeof(uint32_t), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr
+            );
+            mpShadeDispatchArgs = Buffer::create(
+                mpDevice.get(), sizeof(uint32_t) * 3, ResourceBindFlags::UnorderedAccess | ResourceBindFlags::IndirectArg,
+                Buffer::CpuAccess::None, nullptr
+            );
+        }
+        var["gSecondaryHits"] = mpSecondaryHits;
+        var["gHitBinKeys"] = mpHitBinKeys;
+    }
+    else
+    {
+        mpSecondaryHits = nullptr;
+        mpHitBinKeys = nullptr;
+        mpShadeOrder = nullptr;
+        mpHitBinCounters = nullptr;
+        mpDeferredHitCount = nullptr;
+        mpShadeDispatchArgs = nullptr;
+    }
+
+    if (useMotionVectorReprojection() || useScreenSpaceRadianceReuse())
+    {
+        if (!mpCurrGeometry || mpCurrGeometry->getWidth() != mFrameDim.x || mpCurrGeometry->getHeight() != mFrameDim.y)
+        {
+            // Cleared history fails the depth test, so the first frame starts without reuse.
+            for (auto pGeometry : {&mpPrevGeometry, &mpCurrGeometry})
+            {
+                *pGeometry = Texture::create2D(
+                    mpDevice.get(), mFrameDim.x, mFrameDim.y, ResourceFormat::RG32Uint, 1, 1, nullptr,
+                    ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess
+                );
+                pRenderContext->clearUAV((*pGeometry)->getUAV().get(), uint4(0));
+            }
+        }
+        var["gCurrGeometry"] = mpCurrGeometry;
+    }
+    else
+    {
+        mpPrevGeometry = nullptr;
+        mpCurrGeometry = nullptr;
+    }
+
+    if (useScreenSpaceRadianceReuse())
+    {
+        if (!mpCurrRadiance || mpCurrRadiance->getWidth() != mFrameDim.x || mpCurrRadiance->getHeight() != mFrameDim.y)
+        {
+            for (auto pRadiance : {&mpPrevRadiance, &mpCurrRadiance})
+            {
+                *pRadiance = Texture::create2D(
+                    mpDevice.get(), mFrameDim.x, mFrameDim.y, ResourceFormat::RGBA32Float, 1, 1, nullptr,
+                    ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess
+                );
+                pRenderContext->clearUAV((*pRadiance)->getUAV().get(), float4(0.f));
+            }
+        }
+    }
+    else
+    {
+        mpPrevRadiance = nullptr;
+        mpCurrRadiance = nullptr;
+    }
+
+    if (collectReprojectionStats())
+    {
+        if (!mpReprojectionStats)
+            mpReprojectionStats = StatsReadback::create(mpDevice, kReprojectionStatsSize);
+        // The counters of a frame arrive a few frames later, the UI shows the latest.
+        mpReprojectionStats->beginFrame(
+            pRenderContext,
+            [this](const uint32_t* pStats)
+            {
+                mReprojectionAttempts = pStats[0];
+                mReprojectionSuccesses = pStats[1];
+                mReprojectionFallbacks = pStats[2];
+            }
+        );
+    }
+
+    if (useAdaptiveLightSelection())
+        mpLightSelectionStats->beginFrame(pRenderContext);
+
+    if (useReservoirGrid())
+    {
+        const uint32_t capacity = mStaticParams.mReservoirGridCapacity;
+        if (!mpReservoirGridKeys || mpReservoirGridKeys->getElementCount() != capacity)
+        {
+            // Cleared entries are free cells, cleared slots have M == 0.
+            auto createGridBuffer = [&](uint32_t structSize, uint32_t elementCount)
+            {
+                auto pBuffer = Buffer::createStructured(
+                    mpDevice.get(), structSize, elementCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                    Buffer::CpuAccess::None, nullptr, false
+                );
+                pRenderContext->clearUAV(pBuffer->getUAV().get(), uint4(0));
+                return pBuffer;
+            };
+            mpReservoirGridKeys = createGridBuffer(sizeof(uint32_t), capacity);
+            mpReservoirGridStamps = createGridBuffer(sizeof(uint32_t), capacity);
+            mpReservoirGridCursors = createGridBuffer(sizeof(uint32_t), capacity);
+            mpReservoirGridSlots = createGridBuffer(kPackedReservoirSize, capacity * kReservoirGridSlots);
+            mpReservoirGridSlotFrames = createGridBuffer(sizeof(uint32_t), capacity * kReservoirGridSlots);
+        }
+    }
+    else
+    {
+        mpReservoirGridKeys = nullptr;
+        mpReservoirGridStamps = nullptr;
+        mpReservoirGridCursors = nullptr;
+        mpReservoirGridSlots = nullptr;
+        mpReservoirGridSlotFrames = nullptr;
+    }
+
+    if (useRadianceCache())
+    {
+        const uint32_t capacity = mStaticParams.mRadianceCacheCapacity;
+        if (!mpRadianceCacheKeys || mpRadianceCacheKeys->getElementCount() != capacity)
+        {
+            mpRadianceCacheKeys = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), capacity, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpRadianceCacheStamps = Buffer::createStructured(
+                mpDevice.get(), sizeof(uint32_t), capacity, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            mpRadianceCacheAccum = Buffer::create(
+                mpDevice.get(), capacity * kRadianceCacheAccumSize, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr
+            );
+            mpRadianceCacheResolved = Buffer::createStructured(
+                mpDevice.get(), sizeof(float4), capacity, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                Buffer::CpuAccess::None, nullptr, false
+            );
+            for (const auto& pBuffer : {mpRadianceCacheKeys, mpRadianceCacheStamps, mpRadianceCacheAccum, mpRadianceCacheResolved})
+                pRenderContext->clearUAV(pBuffer->getUAV().get(), uint4(0));
+        }
+    }
+    else
+    {
+        mpRadianceCacheKeys = nullptr;
+        mpRadianceCacheStamps = nullptr;
+        mpRadianceCacheAccum = nullptr;
+        mpRadianceCacheResolved = nullptr;
+    }
+
+    if (usePathGuiding())
+    {
+        const uint32_t capacity = mStaticParams.mPathGuidingCapacity;
+        if (!mpPathGuidingKeys || mpPathGuidingKeys->getElementCount() != capacity)
+        {
+            auto createBuffer = [&](uint32_t elementCount)
+            {
+                return Buffer::createStructured(
+                    mpDevice.get(), sizeof(uint32_t), elementCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+                    Buffer::CpuAccess::None, nullptr, false
+                );
+            };
+            mpPathGuidingKeys = createBuffer(capacity);
+            mpPathGuidingStamps = createBuffer(capacity);
+            mpPathGuidingClaims = createBuffer(capacity);
+            mpPathGuidingAccum = createBuffer(capacity * kPathGuidingBins);
+            mpPathGuidingCdf = createBuffer(capacity * kPathGuidingBins);
+            for (const auto& pBuffer : {mpPathGuidingKeys, mpPathGuidingStamps, mpPathGuidingClaims, mpPathGuidingAccum, mpPathGuidingCdf})
+                pRenderContext->clearUAV(pBuffer->getUAV().get(), uint4(0));
+        }
+    }
+    else
+    {
+        mpPathGuidingKeys = nullptr;
+        mpPathGuidingStamps = nullptr;
+        mpPathGuidingClaims = nullptr;
+        mpPathGuidingAccum = nullptr;
+        mpPathGuidingCdf = nullptr;
+    }
+
+    setTemporalShaderData(var, pMotionVector);
+    setLightGridShaderData(var);
+    var["gTileSecondaryParams"] = mpTileSecondaryParams;
 
     var["gVBuffer"] = pVBuffer;
     var["gDepth"] = pDepth;
-    var["gMotionVector"] = pMotionVector;
+
+    const auto& pNoiseTexture = renderData.getTexture(kInputNoise);
+    mNoiseDim = pNoiseTexture ? uint2(pNoiseTexture->getWidth(), pNoiseTexture->getHeight()) : uint2(1, 1);
+    var["gNoise"] = pNoiseTexture;
 
     var["CB"]["gFrameCount"] = mFrameCount;
     var["CB"]["gFrameDim"] = mFrameDim;
+    var["CB"]["gNoiseTexDim"] = mNoiseDim;
+    var["CB"]["gTileDim"] = mTileDim;
     var["CB"]["gRandUint"] = mEngine();
+    const AABB& sceneBounds = mpScene->getSceneBounds();
+    var["CB"]["gSceneBoundsMin"] = sceneBounds.minPoint;
+    var["CB"]["gSceneBoundsExtent"] = sceneBounds.extent();
+    var["CB"]["gHitBinCount"] = getHitBinCount();
 
     FALCOR_ASSERT(mpParamsBlock);
     var["params"] = mpParamsBlock;
 
+    mpLightSampling->setShaderData(var["params"]);
+
+    mpSampleGenerator->setShaderData(var);
+
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+    mpInitialSamplingPass->execute(pRenderContext, {mFrameDim, 1u});
+}
+
+void ReSTIRGIPass::traceSortedSecondaryRays(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    const uint2 sortTileDim = (mFrameDim + kRaySortTileSize - 1u) / kRaySortTileSize;
+
+    if (!mpSortRaysPass)
     {
-        auto paramsVar = var["params"];
+        Program::Desc desc;
+        desc.addShaderLibrary(kSortSecondaryRaysFile).setShaderModel(kShaderModel).csEntry("sortRays");
+        mpSortRaysPass = ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    }
+    mpSortRaysPass->getProgram()->addDefines(getStaticDefines(renderData));
 
-        if (mpScene->useEmissiveLights())
-            FALCOR_ASSERT(mpEmissiveLightSampler);
-        if (mpEmissiveLightSampler)
-            mpEmissiveLightSampler->setShaderData(paramsVar["emissiveSampler"]);
+    {
+        auto var = mpSortRaysPass->getRootVar();
+        var["gSecondaryRayKeys"] = mpSecondaryRayKeys;
+        var["gSecondaryRayOrder"] = mpSecondaryRayOrder;
+        var["CB"]["gFrameDim"] = mFrameDim;
+        var["CB"]["gSortTileDim"] = sortTileDim;
+        mpSortRaysPass->execute(pRenderContext, sortTileDim.x * kRaySortTileSize * kRaySortTileSize / 2u, sortTileDim.y, 1u);
+    }
 
-        if (mpScene->useEnvLight())
-            FALCOR_ASSERT(mpEnvMapSampler);
-        if (mpEnvMapSampler)
-            mpEnvMapSampler->setShaderData(paramsVar["envMapSampler"]);
+    if (!mpTraceSortedRaysPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kInitialSamplingFile).setShaderModel(kShaderModel).csEntry("traceSortedRays");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        mpTraceSortedRaysPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    mpTraceSortedRaysPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    auto var = mpTraceSortedRaysPass->getRootVar();
+    var["gSecondaryRays"] = mpSecondaryRays;
+    var["gSecondaryRayOrder"] = mpSecondaryRayOrder;
+    var["gSecondaryHits"] = mpSecondaryHits;
+    var["gHitBinKeys"] = mpHitBinKeys;
+    setTemporalShaderData(var, renderData.getTexture(kInputMotionVector));
+    setLightGridShaderData(var);
+    if (useWavefrontPathTracer())
+    {
+        // Paths which survive the first hit join queue 0 next to the ones written by the initial sampling kernel.
+        var["gInitialSamples"] = mpInitialSamples;
+        var["gPathQueueOut"] = mpPathQueues[0];
+        var["gPathCountOut"] = mpPathQueueCounters[0];
     }
 
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gFrameDim"] = mFrameDim;
+    var["CB"]["gHitBinCount"] = getHitBinCount();
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
     mpSampleGenerator->setShaderData(var);
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+    mpTraceSortedRaysPass->execute(pRenderContext, kRaySortTileSize * kRaySortTileSize, sortTileDim.x * sortTileDim.y, 1u);
+}
+
+void ReSTIRGIPass::setTemporalShaderData(const ShaderVar& var, const Texture::SharedPtr& pMotionVector)
+{
+    // Every kernel which may finish a path does the temporal lookup itself.
+    var["gTemporalReservoirs"] = mpTemporalReservoirs;
+    var["gIntermediateReservoirs"] = mpIntermediateReservoirs;
+    var["gMotionVector"] = pMotionVector;
+    var["gPrevGeometry"] = mpPrevGeometry;
+    var["gPrevRadiance"] = mpPrevRadiance;
+    var["gReprojectionStats"] = mpReprojectionStats ? mpReprojectionStats->getBuffer() : nullptr;
+    var["gReservoirGridKeys"] = mpReservoirGridKeys;
+    var["gReservoirGridStamps"] = mpReservoirGridStamps;
+    var["gReservoirGridCursors"] = mpReservoirGridCursors;
+    var["gReservoirGridSlots"] = mpReservoirGridSlots;
+    var["gReservoirGridSlotFrames"] = mpReservoirGridSlotFrames;
+
+    // The initial samples are guided, and every kernel which finishes a sample feeds the guiding histograms.
+    var["gPathGuidingKeys"] = mpPathGuidingKeys;
+    var["gPathGuidingStamps"] = mpPathGuidingStamps;
+    var["gPathGuidingClaims"] = mpPathGuidingClaims;
+    var["gPathGuidingAccum"] = mpPathGuidingAccum;
+    var["gPathGuidingCdf"] = mpPathGuidingCdf;
+    // Path vertices look up the radiance cache in every kernel which traces bounces.
+    var["gRadianceCacheKeys"] = mpRadianceCacheKeys;
+    var["gRadianceCacheStamps"] = mpRadianceCacheStamps;
+    var["gRadianceCacheAccum"] = mpRadianceCacheAccum;
+    var["gRadianceCacheResolved"] = mpRadianceCacheResolved;
+    // Spread the update budget uniformly over the frame.
+    const uint32_t pixelCount = mFrameDim.x * mFrameDim.y;
+    var["CB"]["gRadianceCacheUpdateProbability"] =
+        pixelCount > 0 ? std::min(1.f, float(mStaticParams.mRadianceCacheUpdateBudget) / float(pixelCount)) : 0.f;
+}
+
+void ReSTIRGIPass::resolveRadianceCache(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    if (!mpResolveRadianceCachePass)
+    {
+        Program::Desc desc;
+        desc.addShaderLibrary(kRadianceCacheFile).setShaderModel(kShaderModel).csEntry("resolveRadianceCache");
+        mpResolveRadianceCachePass = ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    }
+    mpResolveRadianceCachePass->getProgram()->addDefines(getStaticDefines(renderData));
 
+    auto var = mpResolveRadianceCachePass->getRootVar();
+    var["gRadianceCacheAccum"] = mpRadianceCacheAccum;
+    var["gRadianceCacheResolved"] = mpRadianceCacheResolved;
+    var["CB"]["gCapacity"] = mStaticParams.mRadianceCacheCapacity;
+    mpResolveRadianceCachePass->execute(pRenderContext, mStaticParams.mRadianceCacheCapacity, 1u, 1u);
+}
+
+void ReSTIRGIPass::resolvePathGuiding(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    if (!mpResolvePathGuidingPass)
+    {
+        Program::Desc desc;
+        desc.addShaderLibrary(kPathGuidingFile).setShaderModel(kShaderModel).csEntry("resolvePathGuiding");
+        mpResolvePathGuidingPass = ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    }
+    mpResolvePathGuidingPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    auto var = mpResolvePathGuidingPass->getRootVar();
+    var["gPathGuidingClaims"] = mpPathGuidingClaims;
+    var["gPathGuidingAccum"] = mpPathGuidingAccum;
+    var["gPathGuidingCdf"] = mpPathGuidingCdf;
+    var["CB"]["gCapacity"] = mStaticParams.mPathGuidingCapacity;
+    mpResolvePathGuidingPass->execute(pRenderContext, mStaticParams.mPathGuidingCapacity, 1u, 1u);
+}
+
+void ReSTIRGIPass::buildLightGrid(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    // Cubic cells sized so that the grid over the scene bounds stays within the cell budget.
+    // Flat scenes round up to many more cells than the cube root suggests, so the cells grow until the grid fits.
+    const AABB& sceneBounds = mpScene->getSceneBounds();
+    const float3 extent = sceneBounds.extent();
+    const uint32_t budget = mStaticParams.mLightGridCellBudget;
+    float cellSize = std::cbrt(std::max(extent.x, 1e-3f) * std::max(extent.y, 1e-3f) * std::max(extent.z, 1e-3f) / budget);
+    uint3 dim;
+    while (true)
+    {
+        for (int i = 0; i < 3; i++)
+            dim[i] = std::max(1u, uint32_t(std::ceil(extent[i] / cellSize)));
+        if (uint64_t(dim.x) * dim.y * dim.z <= budget)
+            break;
+        cellSize *= 1.05f;
+    }
+    mLightGridOrigin = sceneBounds.minPoint;
+    mLightGridCellSize = cellSize;
+    mLightGridDim = dim;
+
+    const uint32_t reservoirCount = dim.x * dim.y * dim.z * mStaticParams.mLightGridReservoirs;
+    if (!mpLightGridReservoirs || mpLightGridReservoirs->getElementCount() != reservoirCount)
+    {
+        mpLightGridReservoirs = Buffer::createStructured(
+            mpDevice.get(), kLightGridReservoirSize, reservoirCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess,
+            Buffer::CpuAccess::None, nullptr, false
+        );
+    }
+
+    if (!mpBuildLightGridPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kLightGridFile).setShaderModel(kShaderModel).csEntry("buildLightGrid");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        mpBuildLightGridPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    mpBuildLightGridPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    auto var = mpBuildLightGridPass->getRootVar();
+    var["gLightGridReservoirs"] = mpLightGridReservoirs;
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gLightGridOrigin"] = mLightGridOrigin;
+    var["CB"]["gLightGridCellSize"] = mLightGridCellSize;
+    var["CB"]["gLightGridDim"] = mLightGridDim;
+    mpSampleGenerator->setShaderData(var);
     mpScene->setRaytracingShaderData(pRenderContext, var);
-    mpInitialSamplingPass->execute(pRenderContext, {mFrameDim, 1u});
+    mpBuildLightGridPass->execute(pRenderContext, reservoirCount, 1u, 1u);
+}
+
+void ReSTIRGIPass::setLightGridShaderData(const ShaderVar& var)
+{
+    // Every kernel which shades secondary path vertices samples its analytic lights from the grid.
+    var["gLightGridReservoirs"] = mpLightGridReservoirs;
+    var["CB"]["gLightGridOrigin"] = mLightGridOrigin;
+    var["CB"]["gLightGridCellSize"] = mLightGridCellSize;
+    var["CB"]["gLightGridDim"] = mLightGridDim;
+    // The same kernels pick the light type of their NEE samples.
+    var["gLightSelectionStats"] = mpLightSelectionStats->getBuffer();
+    var["CB"]["gLightTypeProbabilities"] = getLightTypeProbabilities();
+}
+
+uint32_t ReSTIRGIPass::getHitBinCount() const
+{
+    // One bin per material plus bin 0 for the misses.
+    return std::min(mpScene->getMaterialCount(), kMaxHitBins - 1) + 1;
+}
+
+void ReSTIRGIPass::shadeSecondaryHits(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    auto createBinningPass = [&](const std::string& entry)
+    {
+        Program::Desc desc;
+        desc.addShaderLibrary(kBinSecondaryHitsFile).setShaderModel(kShaderModel).csEntry(entry);
+        return ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    };
+    if (!mpCountHitsPass)
+        mpCountHitsPass = createBinningPass("countHits");
+    if (!mpScanHitBinsPass)
+        mpScanHitBinsPass = createBinningPass("scanBins");
+    if (!mpScatterHitsPass)
+        mpScatterHitsPass = createBinningPass("scatterHits");
+
+    FALCOR_ASSERT(mpHitBinKeys && mpHitBinCounters && mpShadeOrder);
+    pRenderContext->clearUAV(mpHitBinCounters->getUAV().get(), uint4(0));
+    for (const auto& pPass : {mpCountHitsPass, mpScanHitBinsPass, mpScatterHitsPass})
+    {
+        pPass->getProgram()->addDefines(getStaticDefines(renderData));
+        auto var = pPass->getRootVar();
+        var["gHitBinKeys"] = mpHitBinKeys;
+        var["gHitBinCounters"] = mpHitBinCounters;
+        var["gShadeOrder"] = mpShadeOrder;
+        var["gDeferredHitCount"] = mpDeferredHitCount;
+        var["gShadeDispatchArgs"] = mpShadeDispatchArgs;
+        var["CB"]["gFrameDim"] = mFrameDim;
+        var["CB"]["gHitBinCount"] = getHitBinCount();
+    }
+    mpCountHitsPass->execute(pRenderContext, {mFrameDim, 1u});
+    mpScanHitBinsPass->execute(pRenderContext, 1u, 1u, 1u);
+    mpScatterHitsPass->execute(pRenderContext, {mFrameDim, 1u});
+
+    if (!mpShadeSecondaryHitsPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kInitialSamplingFile).setShaderModel(kShaderModel).csEntry("shadeSecondaryHits");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        mpShadeSecondaryHitsPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    mpShadeSecondaryHitsPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    auto var = mpShadeSecondaryHitsPass->getRootVar();
+    var["gSecondaryRays"] = mpSecondaryRays;
+    var["gSecondaryHits"] = mpSecondaryHits;
+    var["gShadeOrder"] = mpShadeOrder;
+    var["gDeferredHitCount"] = mpDeferredHitCount;
+    setTemporalShaderData(var, renderData.getTexture(kInputMotionVector));
+    setLightGridShaderData(var);
+    if (useWavefrontPathTracer())
+    {
+        var["gInitialSamples"] = mpInitialSamples;
+        var["gPathQueueOut"] = mpPathQueues[0];
+        var["gPathCountOut"] = mpPathQueueCounters[0];
+    }
+
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gFrameDim"] = mFrameDim;
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpSampleGenerator->setShaderData(var);
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+    mpShadeSecondaryHitsPass->executeIndirect(pRenderContext, mpShadeDispatchArgs.get());
+}
+
+void ReSTIRGIPass::validateSamples(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    // Nothing to validate before the first frame has written its reservoirs.
+    if (!mpTemporalReservoirs || mpTemporalReservoirs->getElementCount() != mFrameDim.x * mFrameDim.y)
+        return;
+
+    if (!mpValidationPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kInitialSamplingFile).setShaderModel(kShaderModel).csEntry("validateSamples");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        mpValidationPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    mpValidationPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    // One pixel of every stride block is validated per frame, cycling through the block over rate frames.
+    const uint32_t rate = mStaticParams.mValidationRate;
+    const uint2 stride = uint2(rate >= 4 ? (rate >= 8 ? 4 : 2) : rate, rate >= 4 ? rate / (rate >= 8 ? 4 : 2) : 1);
+    const uint32_t phase = mFrameCount % rate;
+    const uint2 offset = uint2(phase % stride.x, phase / stride.x);
+
+    auto var = mpValidationPass->getRootVar();
+    // The re-traced paths read the screen-space radiance, the radiance cache and the guiding data like the initial ones.
+    setTemporalShaderData(var, renderData.getTexture(kInputMotionVector));
+    setLightGridShaderData(var);
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gFrameDim"] = mFrameDim;
+    var["CB"]["gValidationStride"] = stride;
+    var["CB"]["gValidationOffset"] = offset;
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpSampleGenerator->setShaderData(var);
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+    mpValidationPass->execute(pRenderContext, (mFrameDim.x + stride.x - 1) / stride.x, (mFrameDim.y + stride.y - 1) / stride.y, 1u);
+}
+
+void ReSTIRGIPass::wavefrontBounces(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    auto createPass = [&](const std::string& entry)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kInitialSamplingFile).setShaderModel(kShaderModel).csEntry(entry);
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        return ComputePass::create(mpDevice, desc, defines, true);
+    };
+    if (!mpBounceArgsPass)
+        mpBounceArgsPass = createPass("prepareBounceArgs");
+    if (!mpWavefrontBouncePass)
+        mpWavefrontBouncePass = createPass("wavefrontBounce");
+    mpBounceArgsPass->getProgram()->addDefines(getStaticDefines(renderData));
+    mpWavefrontBouncePass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    auto var = mpWavefrontBouncePass->getRootVar();
+    setTemporalShaderData(var, renderData.getTexture(kInputMotionVector));
+    setLightGridShaderData(var);
+    var["gInitialSamples"] = mpInitialSamples;
+
+    var["CB"]["gFrameCount"] = mFrameCount;
+    var["CB"]["gFrameDim"] = mFrameDim;
+
+    FALCOR_ASSERT(mpParamsBlock);
+    var["params"] = mpParamsBlock;
+    mpSampleGenerator->setShaderData(var);
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+
+    // The initial sampling kernel filled queue 0. Every bounce consumes one queue and compacts the survivors into the other.
+    for (uint32_t bounce = 0; bounce <= mStaticParams.mMaxBounces; bounce++)
+    {
+        const auto& pIn = mpPathQueues[bounce % 2];
+        const auto& pOut = mpPathQueues[(bounce + 1) % 2];
+        const auto& pCountIn = mpPathQueueCounters[bounce % 2];
+        const auto& pCountOut = mpPathQueueCounters[(bounce + 1) % 2];
+
+        auto argsVar = mpBounceArgsPass->getRootVar();
+        argsVar["gPathCountIn"] = pCountIn;
+        argsVar["gPathCountOut"] = pCountOut;
+        argsVar["gBounceDispatchArgs"] = mpBounceDispatchArgs;
+        mpBounceArgsPass->execute(pRenderContext, 1u, 1u, 1u);
+
+        var["gPathQueueIn"] = pIn;
+        var["gPathQueueOut"] = pOut;
+        var["gPathCountIn"] = pCountIn;
+        var["gPathCountOut"] = pCountOut;
+        var["CB"]["gBounce"] = bounce;
+        mpWavefrontBouncePass->executeIndirect(pRenderContext, mpBounceDispatchArgs.get());
+    }
 }
 
 void ReSTIRGIPass::temporalResamplingHalfRes(RenderContext* pRenderContext, const RenderData& renderData)
@@ -498,60 +1553,90 @@ void ReSTIRGIPass::temporalResamplingHalfRes(RenderContext* pRenderContext, cons
     mpTemporalResamplingPass->execute(pRenderContext, {harfRes, 1u});
 }
 
-// void ReSTIRGIPass::spatialResamplingHalfRes(RenderContext* pRenderContext, const RenderData& renderData, const Texture::SharedPtr&
-// pNoiseTexture)
-//{
-//     //    FALCOR_ASSERT();
-//     if (!mpSpatialResamplingPass)
-//     {
-//         Program::Desc desc;
-//         desc.addShaderModules(mpScene->getShaderModules());
-//         desc.addShaderLibrary(kSpatialSamplingFile).setShaderModel(kShaderModel).csEntry("main");
-//         desc.addTypeConformances(mpScene->getTypeConformances());
-//         auto defines = mpScene->getSceneDefines();
-//         FALCOR_ASSERT(mpSampleGenerator);
-//         defines.add(mpSampleGenerator->getDefines());
-//         defines.add(getStaticDefines());
-//         mpSpatialResamplingPass = ComputePass::create(mpDevice, desc, defines, true);
-//     }
-//
-//     FALCOR_ASSERT(mpSpatialResamplingPass);
-//     mpSpatialResamplingPass->getProgram()->addDefines(getStaticDefines());
-//     auto var = mpSpatialResamplingPass->getRootVar();
-//
-//     if (!mpSpatialReservoirs)
-//     {
-//         uint32_t reservoirCounts = mFrameDim.x * mFrameDim.y;
-//         mpSpatialReservoirs = Buffer::createStructured(
-//             mpDevice.get(), var["gSpatialReservoirs"], reservoirCounts,
-//             ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false
-//         );
-//     }
-//     FALCOR_ASSERT(mpIntermediateReservoirs);
-//     FALCOR_ASSERT(mpSpatialReservoirs);
-//     //    if(!mpSpatialReservoirs){
-//     //        uint32_t reservoirCounts=mFrameDim.x*mFrameDim.y;
-//     //        mpSpatialReservoirs = Buffer::createStructured(
-//     //            mpDevice.get(), var["gSpatialReservoirs"], reservoirCounts, ResourceBindFlags::ShaderResource|
-//     //            ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false
-//     //        );
-//     //    }
-//      var["gTemporalReservoirs"] = mpTemporalReservoirs;
-//     var["gSpatialReservoirs"] = mpSpatialReservoirs;
-//     var["gIntermediateReservoirs"] = mpIntermediateReservoirs;
-//
-//     var["gNoise"] = pNoiseTexture;
-//
-//     var["CB"]["gFrameCount"] = mFrameCount;
-//     var["CB"]["gFrameDim"] = mFrameDim;
-//     var["CB"]["gNoiseTexDim"] = mNoiseDim;
-//
-//     var["gScene"] = mpScene->getParameterBlock();
-//
-//     mpSampleGenerator->setShaderData(var);
-//     mpScene->setRaytracingShaderData(pRenderContext, var);
-//     mpSpatialResamplingPass->execute(pRenderContext, {mFrameDim, 1u});
-// }
+void ReSTIRGIPass::updateSecondaryRayBudget(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    if (!mpTileStatisticsPass)
+    {
+        Program::Desc desc;
+        desc.addShaderLibrary(kAdaptiveSecondaryRaysFile).setShaderModel(kShaderModel).csEntry("computeTileStatistics");
+        mpTileStatisticsPass = ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    }
+    if (!mpLaunchProbabilityPass)
+    {
+        Program::Desc desc;
+        desc.addShaderLibrary(kAdaptiveSecondaryRaysFile).setShaderModel(kShaderModel).csEntry("computeLaunchProbabilities");
+        mpLaunchProbabilityPass = ComputePass::create(mpDevice, desc, getStaticDefines(renderData), true);
+    }
+    mpTileStatisticsPass->getProgram()->addDefines(getStaticDefines(renderData));
+    mpLaunchProbabilityPass->getProgram()->addDefines(getStaticDefines(renderData));
+
+    FALCOR_ASSERT(mpIntermediateReservoirs && mpTileStatistics && mpTileSecondaryParams);
+
+    {
+        auto var = mpTileStatisticsPass->getRootVar();
+        var["gIntermediateReservoirs"] = mpIntermediateReservoirs;
+        var["gTileStatistics"] = mpTileStatistics;
+        var["CB"]["gFrameDim"] = mFrameDim;
+        var["CB"]["gTileDim"] = mTileDim;
+        mpTileStatisticsPass->execute(pRenderContext, {mTileDim * kAdaptiveTileSize, 1u});
+    }
+    {
+        auto var = mpLaunchProbabilityPass->getRootVar();
+        var["gTileStatistics"] = mpTileStatistics;
+        var["gTileSecondaryParams"] = mpTileSecondaryParams;
+        var["CB"]["gTileDim"] = mTileDim;
+        var["CB"]["gRayBudget"] = mStaticParams.mSecondaryRayLaunchProbability;
+        var["CB"]["gMinProbability"] = mStaticParams.mAdaptiveMinProbability;
+        var["CB"]["gDepthBudget"] = mStaticParams.mAdaptiveDepthBudget;
+        mpLaunchProbabilityPass->execute(pRenderContext, 1u, 1u, 1u);
+    }
+}
+
+void ReSTIRGIPass::spatialResampling(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    if (!mpSpatialResamplingPass)
+    {
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kSpatialSamplingFile).setShaderModel(kShaderModel).csEntry("main");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+
+        auto defines = mpScene->getSceneDefines();
+        FALCOR_ASSERT(mpSampleGenerator);
+        defines.add(mpSampleGenerator->getDefines());
+        defines.add(getStaticDefines(renderData));
+        mpSpatialResamplingPass = ComputePass::create(mpDevice, desc, defines, true);
+    }
+    FALCOR_ASSERT(mpSpatialResamplingPass);
+    mpSpatialResamplingPass->getProgram()->addDefines(getStaticDefines(renderData));
+    auto var = mpSpatialResamplingPass->getRootVar();
+
+    const uint32_t reservoirCounts = mFrameDim.x * mFrameDim.y;
+    for (auto& pReservoirs : mpSpatialOutputReservoirs)
+    {
+        if (!pReservoirs || pReservoirs->getElementCount() != reservoirCounts)
+        {
+            pReservoirs = Buffer::createStructured(
+                mpDevice.get(), var["gOutputReservoirs"], reservoirCounts,
+                ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false
+            );
+        }
+    }
+    FALCOR_ASSERT(mpIntermediateReservoirs);
+
+    var["CB"]["gFrameDim"] = mFrameDim;
+    mpSampleGenerator->setShaderData(var);
+    mpScene->setRaytracingShaderData(pRenderContext, var);
+
+    // The intermediate reservoirs become the temporal history, so the iterations ping-pong between separate buffers.
+    for (uint32_t i = 0; i < mStaticParams.mSpatialIterations; i++)
+    {
+        var["gInputReservoirs"] = i == 0 ? mpIntermediateReservoirs : mpSpatialOutputReservoirs[(i - 1) % 2];
+        var["gOutputReservoirs"] = mpSpatialOutputReservoirs[i % 2];
+        var["CB"]["gRandUint"] = mEngine();
+        mpSpatialResamplingPass->execute(pRenderContext, {mFrameDim, 1u});
+    }
+}
 
 void ReSTIRGIPass::finalShading(
     RenderContext* pRenderContext,
@@ -578,16 +1663,24 @@ void ReSTIRGIPass::finalShading(
     mpFinalShadingPass->getProgram()->addDefines(getValidResourceDefines(kOutputChannels, renderData));
     mpFinalShadingPass->getProgram()->addDefines(getStaticDefines(renderData));
     auto var = mpFinalShadingPass->getRootVar();
-    FALCOR_ASSERT(mpSpatialReservoirs);
 
     //    var["gInitSamples"] = mpInitialSamples;
 
-    var["gIntermediateReservoirs"] = mStaticParams.mUseHalfResolutionGI ? mpSpatialReservoirs : mpIntermediateReservoirs;
+    if (mStaticParams.mUseHalfResolutionGI)
+    {
+        FALCOR_ASSERT(mpSpatialReservoirs);
+        var["gIntermediateReservoirs"] = mpSpatialReservoirs;
+    }
+    else if (useSpatialResamplingPass())
+        var["gIntermediateReservoirs"] = mpSpatialOutputReservoirs[(mStaticParams.mSpatialIterations - 1) % 2];
+    else
+        var["gIntermediateReservoirs"] = mpIntermediateReservoirs;
     // var["gNoise"] = pNoiseTexture;
     var["gVBuffer"] = pVBuffer;
     var[kDiffuseReflectanceTexName] = renderData.getTexture(kInputDiffuseReflectance);
     var[kSpecularReflectanceTexName] = renderData.getTexture(kInputSpecularReflectance);
     var["gDirectLighting"] = renderData.getTexture(kInputDirectLighting);
+    var["gCurrRadiance"] = mpCurrRadiance;
 
     var["CB"]["gFrameCount"] = mFrameCount;
     var["CB"]["gFrameDim"] = mFrameDim;
@@ -605,10 +1698,6 @@ void ReSTIRGIPass::finalShading(
         bind(channel);
 
     mpSampleGenerator->setShaderData(var);
-    //    if(mpEmissiveLightSampler)
-    //        mpEmissiveLightSampler->setShaderData(var);
-    //    if(mpEnvMapSampler)
-    //        mpEnvMapSampler->setShaderData(var);
     mpScene->setRaytracingShaderData(pRenderContext, var);
 
     mpFinalShadingPass->execute(pRenderContext, {mFrameDim, 1u});
@@ -616,6 +1705,8 @@ void ReSTIRGIPass::finalShading(
 
 void ReSTIRGIPass::endFrame()
 {
+    mpPrevGeometry.swap(mpCurrGeometry);
+    mpPrevRadiance.swap(mpCurrRadiance);
     if (mStaticParams.mUseHalfResolutionGI)
         mpTemporalReservoirs.swap(mpSpatialReservoirs);
     else
@@ -631,10 +1722,155 @@ void ReSTIRGIPass::renderUI(Gui::Widgets& widget)
     dirty |= mGIResolutionChanged;
     dirty |= widget.var("Secondary Ray Probability", mStaticParams.mSecondaryRayLaunchProbability, 0.f, 1.f);
     dirty |= widget.var("Russian Roulette Probability", mStaticParams.mRussianRouletteProbability, 0.f, 1.f);
+    if (!mStaticParams.mUseHalfResolutionGI)
+    {
+        dirty |= widget.checkbox("Adaptive Secondary Rays", mStaticParams.mUseAdaptiveSecondaryRays);
+        widget.tooltip("Distribute the secondary ray budget and bounce depth per 16x16 tile from the variance of the reservoirs.");
+        if (mStaticParams.mUseAdaptiveSecondaryRays)
+        {
+            dirty |= widget.var("Min Tile Probability", mStaticParams.mAdaptiveMinProbability, 0.001f, 1.f);
+            dirty |= widget.var("Tile Depth Budget", mStaticParams.mAdaptiveDepthBudget, 0.f, 1.f);
+            widget.tooltip("Average ratio of the max bounces the tiles may use. Noisy tiles go deeper than the average, quiet tiles less.");
+        }
+    }
     dirty |= widget.checkbox("Use Multi Bounces", mStaticParams.mUseInfiniteBounces);
     if (mStaticParams.mUseInfiniteBounces)
+    {
         dirty |= widget.var("Max Bounces", mStaticParams.mMaxBounces, 0u, 30u);
+        if (!mStaticParams.mUseHalfResolutionGI)
+        {
+            dirty |= widget.checkbox("Wavefront Path Tracer", mStaticParams.mUseWavefrontPathTracer);
+            widget.tooltip("Trace the multi-bounce paths with one compacted, indirectly dispatched kernel per bounce.");
+            dirty |= widget.checkbox("Radiance Cache", mStaticParams.mUseRadianceCache);
+            widget.tooltip("Stop the multi-bounce paths early and use the radiance cached in a world-space hash grid instead.");
+            if (mStaticParams.mUseRadianceCache && !mStaticParams.mUseWavefrontPathTracer)
+            {
+                dirty |= widget.checkbox("Adaptive Russian Roulette", mStaticParams.mUseAdaptiveRussianRoulette);
+                widget.tooltip(
+                    "Replace the constant Russian roulette with a weight window on the path throughput, which also splits the NEE "
+                    "of bright paths. The window follows the cached radiance of the vertices, so it needs the radiance cache."
+                );
+                if (mStaticParams.mUseAdaptiveRussianRoulette)
+                    dirty |= widget.var("Max NEE Splits", mStaticParams.mMaxNeeSplits, 1u, 16u);
+            }
+        }
+    }
+    if (useRadianceCache())
+    {
+        if (Gui::Group cacheGroup = widget.group("Radiance Cache", true))
+        {
+            dirty |= cacheGroup.var("Cell Size", mStaticParams.mRadianceCacheCellSize, 1e-3f, 10.f);
+            if (cacheGroup.var("Capacity", mStaticParams.mRadianceCacheCapacity, kMinHashGridCapacity, kMaxHashGridCapacity))
+            {
+                mStaticParams.mRadianceCacheCapacity = clampHashGridCapacity(mStaticParams.mRadianceCacheCapacity);
+                dirty = true;
+            }
+            cacheGroup.tooltip("Number of cells, rounded down to a power of two.");
+            dirty |= cacheGroup.var("Spread Threshold", mStaticParams.mRadianceCacheSpreadThreshold, 0.f, 100.f);
+            cacheGroup.tooltip("A path stops at a cached vertex once its footprint exceeds this many cells.");
+            dirty |= cacheGroup.var("Min Bounces", mStaticParams.mRadianceCacheMinBounces, 1u, 30u);
+            dirty |= cacheGroup.var("Update Budget", mStaticParams.mRadianceCacheUpdateBudget, 0u, 1u << 24);
+            cacheGroup.tooltip("Number of secondary samples written to the cache per frame, picked uniformly over the screen.");
+            const uint64_t cacheBytes = uint64_t(mStaticParams.mRadianceCacheCapacity) *
+                                        (2 * sizeof(uint32_t) + kRadianceCacheAccumSize + sizeof(float4));
+            cacheGroup.text(fmt::format("Cache memory: {:.1f} MB", cacheBytes / (1024.0 * 1024.0)));
+        }
+    }
+    if (!mStaticParams.mUseHalfResolutionGI)
+    {
+        dirty |= widget.checkbox("Sort Secondary Rays", mStaticParams.mSortSecondaryRays);
+        widget.tooltip("Sort the secondary rays of each 32x32 tile by direction octant and origin before tracing them.");
+        dirty |= widget.checkbox("Deferred Secondary Shading", mStaticParams.mDeferredSecondaryShading);
+        widget.tooltip("Store only the secondary hits, then shade them grouped by material.");
+    }
     dirty |= widget.checkbox("Exclude EnvMap and Emissive mesh from RIS", mStaticParams.mExcludeEnvMapEmissiveFromRIS);
+    if (!mStaticParams.mExcludeEnvMapEmissiveFromRIS)
+    {
+        dirty |= widget.checkbox("Adaptive Light Type Selection", mStaticParams.mUseAdaptiveLightSelection);
+        widget.tooltip("Pick the light type of the NEE samples in proportion to the contribution measured for each type.");
+        if (useAdaptiveLightSelection())
+        {
+            dirty |= widget.var("Light Type Floor", mStaticParams.mLightSelectionFloor, kMinLightSelectionFloor, 1.f / 3.f);
+            widget.tooltip("Minimum selection probability of every light type used by the scene.");
+            const float3 p = getLightTypeProbabilities();
+            widget.text(fmt::format("EnvMap {:.3f}, Emissive {:.3f}, Analytic {:.3f}", p.x, p.y, p.z));
+        }
+    }
+    if (mpLightSampling)
+    {
+        if (Gui::Group samplingGroup = widget.group("Light Samplers"))
+        {
+            dirty |= samplingGroup.checkbox("Refit Light BVH", mStaticParams.mRefitLightBVH);
+            samplingGroup.tooltip("Refit the light BVH when emissive geometry moves instead of rebuilding it.");
+            mpLightSampling->renderUI(samplingGroup);
+        }
+    }
+    dirty |= widget.checkbox("Light Grid", mStaticParams.mUseLightGrid);
+    widget.tooltip("Sample the analytic lights of the secondary path vertices from a world-space grid of light reservoirs.");
+    if (mStaticParams.mUseLightGrid)
+    {
+        if (Gui::Group gridGroup = widget.group("Light Grid", true))
+        {
+            dirty |= gridGroup.var("Cell Budget", mStaticParams.mLightGridCellBudget, 1u, kMaxLightGridCells);
+            gridGroup.tooltip("Maximum number of cells over the scene bounds.");
+            dirty |= gridGroup.var("Reservoirs per Cell", mStaticParams.mLightGridReservoirs, 1u, kMaxLightGridReservoirs);
+            dirty |= gridGroup.var("Candidates per Reservoir", mStaticParams.mLightGridCandidates, 1u, 64u);
+            if (useLightGrid())
+            {
+                const uint64_t cellCount = uint64_t(mLightGridDim.x) * mLightGridDim.y * mLightGridDim.z;
+                const uint64_t gridBytes = cellCount * mStaticParams.mLightGridReservoirs * kLightGridReservoirSize;
+                gridGroup.text(fmt::format(
+                    "Grid: {}x{}x{} cells of {:.3f}\nGrid memory: {:.1f} MB", mLightGridDim.x, mLightGridDim.y, mLightGridDim.z,
+                    mLightGridCellSize, gridBytes / (1024.0 * 1024.0)
+                ));
+            }
+            else
+            {
+                gridGroup.text("The scene has no analytic lights.");
+            }
+        }
+    }
+    if (!mStaticParams.mUseHalfResolutionGI)
+    {
+        dirty |= widget.checkbox("Path Guiding", mStaticParams.mUsePathGuiding);
+        widget.tooltip(
+            "Sample the secondary rays from a mix of the BSDF and a directional histogram learned per world-space cell "
+            "from the temporal reservoirs. Requires temporal resampling."
+        );
+    }
+    if (usePathGuiding())
+    {
+        if (Gui::Group guidingGroup = widget.group("Path Guiding", true))
+        {
+            dirty |= guidingGroup.var("Guiding Probability", mStaticParams.mPathGuidingProbability, 0.f, kMaxPathGuidingProbability);
+            guidingGroup.tooltip("Probability of sampling the learned distribution instead of the BSDF.");
+            dirty |= guidingGroup.var("Cell Size", mStaticParams.mPathGuidingCellSize, 1e-3f, 10.f);
+            if (guidingGroup.var("Capacity", mStaticParams.mPathGuidingCapacity, kMinHashGridCapacity, kMaxPathGuidingCapacity))
+            {
+                mStaticParams.mPathGuidingCapacity =
+                    std::min(clampHashGridCapacity(mStaticParams.mPathGuidingCapacity), kMaxPathGuidingCapacity);
+                dirty = true;
+            }
+            guidingGroup.tooltip("Number of cells, rounded down to a power of two.");
+            const uint64_t guidingBytes =
+                uint64_t(mStaticParams.mPathGuidingCapacity) * (2 + 2 * kPathGuidingBins) * sizeof(uint32_t);
+            guidingGroup.text(fmt::format("Guiding memory: {:.1f} MB", guidingBytes / (1024.0 * 1024.0)));
+        }
+    }
+    if (!mStaticParams.mUseHalfResolutionGI)
+    {
+        dirty |= widget.checkbox("Screen-Space Radiance Reuse", mStaticParams.mUseScreenSpaceRadianceReuse);
+        widget.tooltip(
+            "Secondary hits which were visible in the previous frame take its shaded radiance instead of continuing the path. "
+            "Connect 'directLighting' so that the direct lighting is reused as well."
+        );
+        if (mStaticParams.mUseScreenSpaceRadianceReuse)
+            dirty |= widget.var("Min Roughness", mStaticParams.mScreenSpaceReuseMinRoughness, 0.f, 1.f);
+        dirty |= widget.dropdown("Interleaved Sampling Rate", kInterleavedSamplingRateList, mStaticParams.mInterleavedSamplingRate);
+        widget.tooltip("Fraction of pixels which trace new secondary paths each frame. The rest rely on temporal and spatial reuse.");
+        dirty |= widget.checkbox("Interleave with Blue Noise", mStaticParams.mInterleaveWithBlueNoise);
+        widget.tooltip("Use the 'noiseTex' input instead of a Bayer matrix to order the interleaved pixels.");
+    }
 
     if (Gui::Group temporalGroup = widget.group("Temporal Resampling", true))
     {
@@ -642,6 +1878,56 @@ void ReSTIRGIPass::renderUI(Gui::Widgets& widget)
         if (mStaticParams.mTemporalResampling)
         {
             dirty |= temporalGroup.var("Reservoir Size", mStaticParams.mTemporalReservoirSize, 1u, 50u);
+            if (!mStaticParams.mUseHalfResolutionGI)
+            {
+                dirty |= temporalGroup.checkbox("Sample Validation", mStaticParams.mUseSampleValidation);
+                temporalGroup.tooltip(
+                    "Re-trace the xv->xs segment of a subset of the temporal reservoirs every frame, "
+                    "invalidating occluded samples and refreshing Lo when the lighting changed."
+                );
+                if (mStaticParams.mUseSampleValidation)
+                {
+                    dirty |= temporalGroup.dropdown("Validation Rate", kValidationRateList, mStaticParams.mValidationRate);
+                    dirty |= temporalGroup.var("Validation Threshold", mStaticParams.mValidationThreshold, 0.f, 1.f);
+                    temporalGroup.tooltip("Relative luminance change above which the history of a reservoir is reset.");
+                }
+                dirty |= temporalGroup.checkbox("Motion Vector Reprojection", mStaticParams.mUseMotionVectorReprojection);
+                temporalGroup.tooltip(
+                    "Reproject with the motion vectors, trying the 2x2 footprint and then the camera reprojection, "
+                    "and reject candidates whose view distance or normal history does not match."
+                );
+                if (mStaticParams.mUseMotionVectorReprojection)
+                {
+                    dirty |= temporalGroup.var("Depth Threshold", mStaticParams.mReprojectionDepthThreshold, 0.f, 1.f);
+                    temporalGroup.tooltip("Maximum relative difference between the view distance and its history.");
+                    dirty |= temporalGroup.var("Normal Threshold", mStaticParams.mReprojectionNormalThreshold, -1.f, 1.f);
+                    temporalGroup.tooltip("Minimum cosine between the normal and its history.");
+                }
+                dirty |= temporalGroup.checkbox("World-Space Reservoir Grid", mStaticParams.mUseReservoirGrid);
+                temporalGroup.tooltip("Keep a few reservoirs per world-space cell and normal bucket, and seed disoccluded pixels from them.");
+                if (mStaticParams.mUseReservoirGrid)
+                {
+                    dirty |= temporalGroup.var("Grid Cell Size", mStaticParams.mReservoirGridCellSize, 1e-3f, 10.f);
+                    if (temporalGroup.var("Grid Capacity", mStaticParams.mReservoirGridCapacity, kMinHashGridCapacity, kMaxHashGridCapacity))
+                    {
+                        mStaticParams.mReservoirGridCapacity = clampHashGridCapacity(mStaticParams.mReservoirGridCapacity);
+                        dirty = true;
+                    }
+                    temporalGroup.tooltip("Number of cells, rounded down to a power of two.");
+                    const uint64_t gridBytes = uint64_t(mStaticParams.mReservoirGridCapacity) *
+                                               (3 * sizeof(uint32_t) + kReservoirGridSlots * (kPackedReservoirSize + sizeof(uint32_t)));
+                    temporalGroup.text(fmt::format("Grid memory: {:.1f} MB", gridBytes / (1024.0 * 1024.0)));
+                }
+                dirty |= temporalGroup.checkbox("Reuse Statistics", mStaticParams.mCollectReprojectionStats);
+                if (collectReprojectionStats() && mReprojectionAttempts > 0)
+                {
+                    const float attempts = float(mReprojectionAttempts);
+                    temporalGroup.text(fmt::format(
+                        "Temporal reuse: {:.1f}% of {} lookups\nCamera fallback: {:.1f}%", 100.f * mReprojectionSuccesses / attempts,
+                        mReprojectionAttempts, 100.f * mReprojectionFallbacks / attempts
+                    ));
+                }
+            }
         }
     }
     if (auto spatialGroup = widget.group("Spatial Resampling", true))
@@ -652,6 +1938,22 @@ void ReSTIRGIPass::renderUI(Gui::Widgets& widget)
             dirty |= spatialGroup.var("Neighbors Count", mStaticParams.mSpatialNeighborsCount, 1u, 50u);
             dirty |= spatialGroup.var("Sample Radius", mStaticParams.mSampleRadius, 1u, 500u);
             dirty |= spatialGroup.var("Reservoir Size", mStaticParams.mSpatialReservoirSize, 1u, 500u);
+            if (!mStaticParams.mUseHalfResolutionGI)
+            {
+                dirty |= spatialGroup.checkbox("Separate Pass", mStaticParams.mUseSpatialResamplingPass);
+                spatialGroup.tooltip("Run spatial resampling in its own pass, drawing near neighbors from a groupshared tile cache.");
+                if (mStaticParams.mUseSpatialResamplingPass)
+                {
+                    dirty |= spatialGroup.var("Iterations", mStaticParams.mSpatialIterations, 1u, 4u);
+                    dirty |= spatialGroup.var("Far Sample Ratio", mStaticParams.mSpatialFarSampleRatio, 0.f, 1.f);
+                    spatialGroup.tooltip("Share of the neighbors drawn from the full radius instead of the cached 8 pixel apron.");
+                    dirty |= spatialGroup.checkbox("Unbiased", mStaticParams.mUnbiasedSpatialResampling);
+                    spatialGroup.tooltip(
+                        "Jacobian corrected target PDFs, balance heuristic MIS and per-neighbor visibility. "
+                        "Usually reaches the same quality with fewer neighbors."
+                    );
+                }
+            }
         }
     }
 
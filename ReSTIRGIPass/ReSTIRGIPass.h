@@ -7,6 +7,9 @@
 #include "Rendering/Lights/LightBVHSampler.h"
 #include "Rendering/Lights/EmissivePowerSampler.h"
 #include "Rendering/Lights/EnvMapSampler.h"
+#include "../Common/LightSamplingService.h"
+#include "../Common/LightSelectionStats.h"
+#include "../Common/StatsReadback.h"
 #include <random>
 
 using namespace Falcor;
@@ -38,6 +41,21 @@ private:
     void parseDictionary(const Dictionary& dict);
 
     Program::DefineList getStaticDefines(const RenderData& renderData);
+    bool useWavefrontPathTracer() const
+    {
+        return mStaticParams.mUseWavefrontPathTracer && mStaticParams.mUseInfiniteBounces && !mStaticParams.mUseHalfResolutionGI;
+    }
+
+    // The contribution estimates of the path vertices come from the radiance cache, without it the window would only
+    // follow the throughput.
+    bool useAdaptiveRussianRoulette() const
+    {
+        return mStaticParams.mUseAdaptiveRussianRoulette && useRadianceCache() && !useWavefrontPathTracer();
+    }
+
+    bool useSortedSecondaryRays() const { return mStaticParams.mSortSecondaryRays && !mStaticParams.mUseHalfResolutionGI; }
+    bool useDeferredSecondaryShading() const { return mStaticParams.mDeferredSecondaryShading && !mStaticParams.mUseHalfResolutionGI; }
+    uint32_t getHitBinCount() const;
 
     void prepareResources(RenderContext* pRenderContext, const RenderData& renderData);
 
@@ -49,10 +67,66 @@ private:
         const Texture::SharedPtr& pMotionVector
     );
 
+    void traceSortedSecondaryRays(RenderContext* pRenderContext, const RenderData& renderData);
+
+    void shadeSecondaryHits(RenderContext* pRenderContext, const RenderData& renderData);
+
+    bool useSampleValidation() const
+    {
+        return mStaticParams.mUseSampleValidation && mStaticParams.mTemporalResampling && !mStaticParams.mUseHalfResolutionGI;
+    }
+    void validateSamples(RenderContext* pRenderContext, const RenderData& renderData);
+
+    bool useMotionVectorReprojection() const
+    {
+        return mStaticParams.mUseMotionVectorReprojection && mStaticParams.mTemporalResampling && !mStaticParams.mUseHalfResolutionGI;
+    }
+    bool useScreenSpaceRadianceReuse() const { return mStaticParams.mUseScreenSpaceRadianceReuse && !mStaticParams.mUseHalfResolutionGI; }
+    bool collectReprojectionStats() const
+    {
+        return mStaticParams.mCollectReprojectionStats && mStaticParams.mTemporalResampling && !mStaticParams.mUseHalfResolutionGI;
+    }
+    bool useReservoirGrid() const
+    {
+        return mStaticParams.mUseReservoirGrid && mStaticParams.mTemporalResampling && !mStaticParams.mUseHalfResolutionGI;
+    }
+    bool useRadianceCache() const
+    {
+        return mStaticParams.mUseRadianceCache && mStaticParams.mUseInfiniteBounces && !mStaticParams.mUseHalfResolutionGI;
+    }
+    void resolveRadianceCache(RenderContext* pRenderContext, const RenderData& renderData);
+    bool useLightGrid() const
+    {
+        return mStaticParams.mUseLightGrid && mpScene && mpScene->useAnalyticLights() && mpScene->getActiveLightCount() > 0;
+    }
+    void buildLightGrid(RenderContext* pRenderContext, const RenderData& renderData);
+    bool usePathGuiding() const
+    {
+        return mStaticParams.mUsePathGuiding && mStaticParams.mTemporalResampling && !mStaticParams.mUseHalfResolutionGI;
+    }
+    void resolvePathGuiding(RenderContext* pRenderContext, const RenderData& renderData);
+    bool useAdaptiveLightSelection() const
+    {
+        return mStaticParams.mUseAdaptiveLightSelection && !mStaticParams.mExcludeEnvMapEmissiveFromRIS;
+    }
+    float3 getLightTypeProbabilities() const
+    {
+        return mpLightSelectionStats->getLightTypeProbabilities(mpScene, mStaticParams.mLightSelectionFloor);
+    }
+    void setLightGridShaderData(const ShaderVar& var);
+    void setTemporalShaderData(const ShaderVar& var, const Texture::SharedPtr& pMotionVector);
+
+    void wavefrontBounces(RenderContext* pRenderContext, const RenderData& renderData);
+
     void temporalResamplingHalfRes(RenderContext* pRenderContext, const RenderData& renderData);
 
-    //    void spatialResamplingHalfRes(RenderContext* pRenderContext, const RenderData& renderData, const Texture::SharedPtr&
-    //    pNoiseTexture);
+    void updateSecondaryRayBudget(RenderContext* pRenderContext, const RenderData& renderData);
+
+    bool useSpatialResamplingPass() const
+    {
+        return mStaticParams.mSpatialResampling && mStaticParams.mUseSpatialResamplingPass && !mStaticParams.mUseHalfResolutionGI;
+    }
+    void spatialResampling(RenderContext* pRenderContext, const RenderData& renderData);
 
     void finalShading(
         RenderContext* pRenderContext,
@@ -68,18 +142,87 @@ private:
     ComputePass::SharedPtr mpInitialSamplingPass;
     ComputePass::SharedPtr mpTemporalResamplingPass;
     ComputePass::SharedPtr mpSpatialResamplingPass;
+    ComputePass::SharedPtr mpValidationPass;
     ComputePass::SharedPtr mpFinalShadingPass;
+    ComputePass::SharedPtr mpBounceArgsPass;
+    ComputePass::SharedPtr mpWavefrontBouncePass;
+    ComputePass::SharedPtr mpTileStatisticsPass;
+    ComputePass::SharedPtr mpLaunchProbabilityPass;
+    ComputePass::SharedPtr mpSortRaysPass;
+    ComputePass::SharedPtr mpTraceSortedRaysPass;
+    ComputePass::SharedPtr mpCountHitsPass;
+    ComputePass::SharedPtr mpScanHitBinsPass;
+    ComputePass::SharedPtr mpScatterHitsPass;
+    ComputePass::SharedPtr mpShadeSecondaryHitsPass;
+    ComputePass::SharedPtr mpResolveRadianceCachePass;
+    ComputePass::SharedPtr mpBuildLightGridPass;
+    ComputePass::SharedPtr mpResolvePathGuidingPass;
 
     Buffer::SharedPtr mpInitialSamples;
     Buffer::SharedPtr mpTemporalReservoirs;
     Buffer::SharedPtr mpIntermediateReservoirs;
     Buffer::SharedPtr mpSpatialReservoirs;
+    Buffer::SharedPtr mpSpatialOutputReservoirs[2];
+    Buffer::SharedPtr mpPathQueues[2];
+    Buffer::SharedPtr mpPathQueueCounters[2];
+    Buffer::SharedPtr mpBounceDispatchArgs;
+    Buffer::SharedPtr mpTileStatistics;
+    Buffer::SharedPtr mpTileSecondaryParams;
+    Buffer::SharedPtr mpSecondaryRays;
+    Buffer::SharedPtr mpSecondaryRayKeys;
+    Buffer::SharedPtr mpSecondaryRayOrder;
+    Buffer::SharedPtr mpSecondaryHits;
+    Buffer::SharedPtr mpHitBinKeys;
+    Buffer::SharedPtr mpHitBinCounters;
+    Buffer::SharedPtr mpShadeOrder;
+    Buffer::SharedPtr mpDeferredHitCount;
+    Buffer::SharedPtr mpShadeDispatchArgs;
+    StatsReadback::SharedPtr mpReprojectionStats;
+    uint32_t mReprojectionAttempts = 0;
+    uint32_t mReprojectionSuccesses = 0;
+    uint32_t mReprojectionFallbacks = 0;
+
+    // Contribution statistics per light type, in EnvMap, Emissive, Analytic order.
+    LightSelectionStats::SharedPtr mpLightSelectionStats;
+
+    // Distance to the camera and normal of the visibility points, for the disocclusion tests.
+    Texture::SharedPtr mpPrevGeometry;
+    Texture::SharedPtr mpCurrGeometry;
+    // Radiance shaded by the final shading, reused by the secondary hits of the next frame.
+    Texture::SharedPtr mpPrevRadiance;
+    Texture::SharedPtr mpCurrRadiance;
+
+    // World-space hash grid of reservoirs which disoccluded pixels are seeded from.
+    Buffer::SharedPtr mpReservoirGridKeys;
+    Buffer::SharedPtr mpReservoirGridStamps;
+    Buffer::SharedPtr mpReservoirGridCursors;
+    Buffer::SharedPtr mpReservoirGridSlots;
+    Buffer::SharedPtr mpReservoirGridSlotFrames;
+
+    // World-space hash grid of outgoing radiance which terminates the multi-bounce paths.
+    Buffer::SharedPtr mpRadianceCacheKeys;
+    Buffer::SharedPtr mpRadianceCacheStamps;
+    Buffer::SharedPtr mpRadianceCacheAccum;
+    Buffer::SharedPtr mpRadianceCacheResolved;
+
+    // World-space grid of analytic light reservoirs over the scene bounds, rebuilt every frame.
+    Buffer::SharedPtr mpLightGridReservoirs;
+    float3 mLightGridOrigin = float3(0.f);
+    float mLightGridCellSize = 1.f;
+    uint3 mLightGridDim = uint3(1);
+
+    // World-space hash grid of directional histograms which guide the secondary rays.
+    Buffer::SharedPtr mpPathGuidingKeys;
+    Buffer::SharedPtr mpPathGuidingStamps;
+    Buffer::SharedPtr mpPathGuidingClaims;
+    Buffer::SharedPtr mpPathGuidingAccum;
+    Buffer::SharedPtr mpPathGuidingCdf;
 
     //    Texture::SharedPtr mpPrimaryThroughput;
 
     SampleGenerator::SharedPtr mpSampleGenerator;
-    EnvMapSampler::SharedPtr mpEnvMapSampler;
-    EmissiveLightSampler::SharedPtr mpEmissiveLightSampler;
+    // Emissive and environment map samplers, shared with the other passes of the graph.
+    LightSamplingService::SharedPtr mpLightSampling;
 
     std::mt19937 mEngine;
 
@@ -92,16 +235,71 @@ private:
         bool mUseImportanceSampling = true;
         uint mMaxBounces = 10;
         bool mUseInfiniteBounces = true;
+        // Run the multi-bounce part as one compacted dispatch per bounce instead of a megakernel loop.
+        bool mUseWavefrontPathTracer = false;
+        // Terminate the multi-bounce paths with a world-space radiance cache once their spread is large enough.
+        bool mUseRadianceCache = false;
+        float mRadianceCacheCellSize = 0.25f;
+        uint mRadianceCacheCapacity = 1u << 18;
+        float mRadianceCacheSpreadThreshold = 2.f;
+        uint mRadianceCacheMinBounces = 1;
+        uint mRadianceCacheUpdateBudget = 1u << 18;
+        // Sample the analytic lights of the secondary vertices from a world-space grid of light reservoirs.
+        bool mUseLightGrid = false;
+        uint mLightGridCellBudget = 1u << 15;
+        uint mLightGridReservoirs = 16;
+        uint mLightGridCandidates = 16;
+        // Guide the secondary rays with directional histograms learned per world-space cell from the temporal reservoirs.
+        bool mUsePathGuiding = false;
+        float mPathGuidingProbability = 0.5f;
+        float mPathGuidingCellSize = 0.5f;
+        uint mPathGuidingCapacity = 1u << 14;
+        // Weight-window Russian roulette and NEE splitting instead of the constant survival probability. Megakernel only.
+        bool mUseAdaptiveRussianRoulette = false;
+        uint mMaxNeeSplits = 4;
+        // Sort the secondary rays by direction and origin before tracing them to improve coherence.
+        bool mSortSecondaryRays = false;
+        // Trace the secondary rays first and shade their hits afterwards, grouped by material.
+        bool mDeferredSecondaryShading = false;
         bool mExcludeEnvMapEmissiveFromRIS = true;
+        // Learn the light type selection probabilities of the NEE samples from their measured contribution.
+        bool mUseAdaptiveLightSelection = false;
+        float mLightSelectionFloor = 0.05f;
+        // Refit the shared light BVH when the emissive geometry changes, rebuild it otherwise.
+        bool mRefitLightBVH = true;
+        // Distribute secondary rays and bounce depth per screen tile from reservoir variance.
+        bool mUseAdaptiveSecondaryRays = false;
+        float mAdaptiveMinProbability = 0.02f;
+        // Average ratio of kMaxBounces over the tiles, below 1 so that noisy tiles can go deeper than the average.
+        float mAdaptiveDepthBudget = 0.5f;
 
         bool mUseEnvLight = true;
         bool mUseEmissiveLights = true;
         bool mUseAnalyticsLights = true;
         bool mUseHalfResolutionGI = false;
+        // Only 1 / mInterleavedSamplingRate pixels launch new secondary paths each frame.
+        uint mInterleavedSamplingRate = 1;
+        bool mInterleaveWithBlueNoise = false;
 
         // Temporal Resampling Settings
         bool mTemporalResampling = true;
         uint mTemporalReservoirSize = 20;
+        // Re-trace 1 / mValidationRate of the temporal reservoirs each frame to catch lighting and visibility changes.
+        bool mUseSampleValidation = false;
+        uint mValidationRate = 8;
+        float mValidationThreshold = 0.5f;
+        // Reproject with the motion vectors and check the view distance and normal history of the candidates.
+        bool mUseMotionVectorReprojection = false;
+        float mReprojectionDepthThreshold = 0.1f;
+        float mReprojectionNormalThreshold = 0.9f;
+        bool mCollectReprojectionStats = false;
+        // Take the previous frame's shaded radiance for secondary hits which were visible on screen.
+        bool mUseScreenSpaceRadianceReuse = false;
+        float mScreenSpaceReuseMinRoughness = 0.3f;
+        // Seed disoccluded pixels from a world-space hash grid of recent reservoirs.
+        bool mUseReservoirGrid = false;
+        float mReservoirGridCellSize = 0.25f;
+        uint mReservoirGridCapacity = 1u << 16;
 
         // Spatial Resampling Settings
         bool mSpatialResampling = true;
@@ -109,6 +307,12 @@ private:
         uint mSampleRadius = 100;
         uint mSpatialReservoirSize = 100;
         bool mDoVisibilityTestEachSamples = false;
+        // Full resolution only: resample in a separate pass instead of inside the final shading.
+        bool mUseSpatialResamplingPass = false;
+        uint mSpatialIterations = 1;
+        float mSpatialFarSampleRatio = 0.25f;
+        // Jacobian corrected, MIS weighted spatial reuse with per-neighbor visibility. Requires the separate pass.
+        bool mUnbiasedSpatialResampling = false;
 
         // debug
         bool mEvalDirect = true;
@@ -119,6 +323,7 @@ private:
 
     uint2 mFrameDim = uint2(0, 0);
     uint2 mNoiseDim = uint2(0, 0);
+    uint2 mTileDim = uint2(0, 0);
     uint mFrameCount = 0;
     bool mOptionsChanged = false;
     bool mGIResolutionChanged = false;